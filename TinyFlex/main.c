@@ -74,22 +74,22 @@ int main( int argc, char * argv[] )
     initializePrinter(detailpath, pgm, LER);// init logger in /lib/log.c
     // for the lexical analysis, you might change LOGALL to LER, to generate only lex and err outputs.
       
-  fprintf(listing,"\nTINY COMPILATION: %s\n",pgm);
+  pp(OUT,"\nTINY COMPILATION: %s\n",pgm);
 #if NO_PARSE
   while (getToken()!=ENDFILE);
 #else
   syntaxTree = parse();
   if (TraceParse) {
-    fprintf(listing,"\nSyntax tree:\n");
+    pp(OUT,"\nSyntax tree:\n");
     printTree(syntaxTree);
   }
 #if !NO_ANALYZE
   if (! Error)
-  { if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table...\n");
+  { if (TraceAnalyze) pp(OUT,"\nBuilding Symbol Table...\n");
     buildSymtab(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nChecking Types...\n");
+    if (TraceAnalyze) pp(OUT,"\nChecking Types...\n");
     typeCheck(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
+    if (TraceAnalyze) pp(OUT,"\nType Checking Finished\n");
   }
 #if !NO_CODE
   if (! Error)
@@ -100,7 +100,7 @@ int main( int argc, char * argv[] )
     strcat(codefile,".tm");
     code = fopen(codefile,"w");
     if (code == NULL)
-    { printf("Unable to open %s\n",codefile);
+    { pp(OUT,"Unable to open %s\n",codefile);
       exit(1);
     }
     codeGen(syntaxTree,codefile);
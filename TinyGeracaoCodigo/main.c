@@ -75,24 +75,24 @@ int main( int argc, char * argv[] )
     initializePrinter(detailpath, pgm, LOGALL);// init logger in /lib/log.c
     // for the lexical analysis, you might change LOGALL to LER, to generate only lex and err outputs.
     
-  fprintf(listing,"\nCOMPILATION: %s\n",pgm); // messages on stderr are useful only when calling the compiler manually.
+  pp(OUT,"\nCOMPILATION: %s\n",pgm); // messages on stderr are useful only when calling the compiler manually.
 #if NO_PARSE
   while (getToken()!=ENDFILE);// getToken is in the .l file
 #else
   syntaxTree = parse();
   doneLEXstartSYN();// Lexical analysis ended. Now, print on SYN output file
   if (TraceParse) {
-    fprintf(listing,"\nSyntax tree:\n");
+    pp(OUT,"\nSyntax tree:\n");
     printTree(syntaxTree);
   }
 #if !NO_ANALYZE
   doneSYNstartTAB();// SyntaxTree analysis ended. Now, print on TAB output file
   if (! Error)
-  { if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table...\n");
+  { if (TraceAnalyze) pp(OUT,"\nBuilding Symbol Table...\n");
     buildSymtab(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nChecking Types...\n");
+    if (TraceAnalyze) pp(OUT,"\nChecking Types...\n");
     typeCheck(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
+    if (TraceAnalyze) pp(OUT,"\nType Checking Finished\n");
   }
 #if !NO_CODE
   doneTABstartGEN();// Symbol Table is done. Now, print on GEN file (final compiled code output)
@@ -0,0 +1,137 @@
+/****************************************************/
+/* File: bench.c                                    */
+/* Timing harness of the component benchmarks       */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+static int warmups = 3;      /* -w */
+static int repetitions = 15; /* -r */
+
+static double now(void)
+{ struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int benchOptions(int argc, char * argv[], long * size, const char * usage)
+{ int i;
+  for (i = 1; i < argc && argv[i][0] == '-'; i++)
+  { if (i + 1 >= argc) break;
+    if (strcmp(argv[i],"-w") == 0) warmups = atoi(argv[++i]);
+    else if (strcmp(argv[i],"-r") == 0) repetitions = atoi(argv[++i]);
+    else if (strcmp(argv[i],"-n") == 0) *size = atol(argv[++i]);
+    else break;
+  }
+  if ((i < argc && argv[i][0] == '-') || warmups < 0 || repetitions < 1 || *size < 1)
+  { fprintf(stderr,"usage: %s [-w warmups] [-r runs] [-n size] %s\n",argv[0],usage);
+    exit(1);
+  }
+  return i;
+}
+
+static int byTime(const void * a, const void * b)
+{ double x = *(const double *) a, y = *(const double *) b;
+  return x < y ? -1 : x > y;
+}
+
+/* the p-th percentile of n sorted times, nearest rank */
+static double percentile(const double * t, int n, int p)
+{ int k = (p * n + 99) / 100;
+  return t[k < 1 ? 0 : k - 1];
+}
+
+void benchRun(const char * name, BenchFn fn, void * data, const char * unit)
+{ double * times = (double *) malloc(repetitions * sizeof(double));
+  double units = 0, median;
+  int i;
+  for (i = 0; i < warmups; i++)
+    fn(data);
+  for (i = 0; i < repetitions; i++)
+  { double t0 = now();
+    units = fn(data);
+    times[i] = now() - t0;
+  }
+  qsort(times,repetitions,sizeof(double),byTime);
+  median = percentile(times,repetitions,50);
+  printf("%-28s %9.3f ms  p10 %9.3f  p90 %9.3f  max %9.3f  %10.3g %s/s\n",
+         name,median * 1e3,percentile(times,repetitions,10) * 1e3,
+         percentile(times,repetitions,90) * 1e3,times[repetitions - 1] * 1e3,
+         median > 0 ? units / median : 0,unit);
+  fflush(stdout);
+  free(times);
+}
+
+/* one function of benchSource: a loop, a selection, array
+ * indexing, a call and nested expressions */
+static const char * function =
+  "/* f%s: largest of the first n, or a running sum */\n"
+  "int f%s(int a[], int n)\n"
+  "{ int i; int s;\n"
+  "  i = 0; s = 0;\n"
+  "  while (i < n)\n"
+  "  { if (a[i] > s) s = a[i];\n"
+  "    else s = s + a[i] * 2 - (i + 1) / 3;\n"
+  "    i = i + 1;\n"
+  "  }\n"
+  "  return s + f%s(a, n - 1);\n"
+  "}\n\n";
+
+/* i in base 26 with the letters, as C- names have no digits */
+static char * letters(long i, char * buf)
+{ char tmp[16];
+  int n = 0, k = 0;
+  do
+  { tmp[n++] = 'a' + i % 26;
+    i /= 26;
+  } while (i > 0);
+  while (n > 0)
+    buf[k++] = tmp[--n];
+  buf[k] = '\0';
+  return buf;
+}
+
+char * benchSource(long functions, size_t * len)
+{ size_t cap = 512 + functions * (strlen(function) + 64);
+  char * text = (char *) malloc(cap);
+  char name[16], callee[16];
+  size_t n = 0;
+  long i;
+  for (i = 0; i < functions; i++)
+  { letters(i,name);
+    letters(i > 0 ? i - 1 : 0,callee);
+    n += snprintf(text + n,cap - n,function,name,name,callee);
+  }
+  n += snprintf(text + n,cap - n,
+                "void main(void)\n{ int x[10];\n  output(f%s(x, 10));\n}\n",
+                letters(functions - 1,name));
+  *len = n;
+  return text;
+}
+
+char * benchReadFile(const char * file, size_t * len)
+{ FILE * f = fopen(file,"rb");
+  char * text;
+  long n;
+  if (f == NULL)
+  { perror(file);
+    exit(1);
+  }
+  fseek(f,0,SEEK_END);
+  n = ftell(f);
+  rewind(f);
+  text = (char *) malloc(n + 1);
+  if (fread(text,1,n,f) != (size_t) n)
+  { perror(file);
+    exit(1);
+  }
+  fclose(f);
+  text[n] = '\0';
+  *len = n;
+  return text;
+}
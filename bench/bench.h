@@ -0,0 +1,37 @@
+/****************************************************/
+/* File: bench.h                                    */
+/* Timing harness of the component benchmarks       */
+/* (bench_lex, bench_parse, bench_symtab, ...)      */
+/****************************************************/
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stddef.h>
+
+/* one run of a benchmark; returns the units of work it did
+ * (tokens, nodes, calls, instructions) */
+typedef double (*BenchFn)(void * data);
+
+/* the options every benchmark takes:
+ *   -w N   untimed warmup runs (default 3)
+ *   -r N   timed runs (default 15)
+ *   -n N   size of the workload, whose meaning and default
+ *          are the benchmark's (size is left alone if absent)
+ * Returns the index of the first argument left (a file), or
+ * exits with the usage on a wrong one */
+int benchOptions(int argc, char * argv[], long * size, const char * usage);
+
+/* runs fn the warmup runs, then times the timed ones; prints a
+ * line with the median, p10, p90 and max time of a run and the
+ * throughput at the median, in units per second */
+void benchRun(const char * name, BenchFn fn, void * data, const char * unit);
+
+/* a valid C- program of functions functions, about 10 lines
+ * each, and main; to be freed */
+char * benchSource(long functions, size_t * len);
+
+/* the contents of file, to be freed; exits if it cannot be read */
+char * benchReadFile(const char * file, size_t * len);
+
+#endif
@@ -0,0 +1,48 @@
+/****************************************************/
+/* File: bench_lex.c                                */
+/* Scanner throughput: getToken over a source in    */
+/* memory, in tokens per second                     */
+/****************************************************/
+
+#include "globals.h"
+#include "scan.h"
+#include "diag.h"
+#include "bench.h"
+
+typedef struct
+{ char * text;
+  size_t len;
+} Input;
+
+/* one run: every token of the source */
+static double scanAll(void * data)
+{ Input * in = (Input *) data;
+  long tokens = 0;
+  source = fmemopen(in->text,in->len,"r");
+  redundant_source = fmemopen(in->text,in->len,"r");
+  resetScanner();
+  diagReset();
+  while (getToken() != ENDFILE) tokens++;
+  fclose(source);
+  fclose(redundant_source);
+  return tokens;
+}
+
+int main(int argc, char * argv[])
+{ long functions = 2000; /* -n: of the generated source */
+  Input in;
+  int first = benchOptions(argc,argv,&functions,"[file.cm]");
+
+  if (first < argc) in.text = benchReadFile(argv[first],&in.len);
+  else in.text = benchSource(functions,&in.len);
+  /* no listing: only the scanning is timed */
+  EchoSource = TraceScan = FALSE;
+  mirrorStdout(FALSE);
+  initializePrinter("/tmp","bench_lex.cm",0);
+  listing = stdout;
+
+  printf("%s: %zu bytes\n",first < argc ? argv[first] : "generated source",in.len);
+  benchRun("getToken",scanAll,&in,"tokens");
+  free(in.text);
+  return 0;
+}
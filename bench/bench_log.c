@@ -0,0 +1,47 @@
+/****************************************************/
+/* File: bench_log.c                                */
+/* Listing output (lib/log.c): pc() calls per       */
+/* second into a stage file, memory and nowhere     */
+/****************************************************/
+
+#include <unistd.h>
+#include "globals.h"
+#include "bench.h"
+
+typedef struct
+{ long calls;
+  SinkRoute route;
+} Output;
+
+/* one run: a lex listing of calls lines */
+static double printAll(void * data)
+{ Output * o = (Output *) data;
+  long i;
+  initializePrinter("/tmp","bench_log.cm",LEX);
+  for (i = 0; i < o->calls; i++)
+    pc("\t%ld: ID, name= %s\n",i,"identifier");
+  closePrinter();
+  if (o->route == ROUTE_MEMORY)
+  { size_t len;
+    free(takeStageBuffer(LEX,&len));
+  }
+  return o->calls;
+}
+
+int main(int argc, char * argv[])
+{ static const struct { SinkRoute route; const char * name; } routes[] =
+  { { ROUTE_FILE, "pc (file /tmp/bench_log_lex.txt)" }, { ROUTE_MEMORY, "pc (memory)" },
+    { ROUTE_DISCARD, "pc (discarded)" } };
+  Output o = { 200000, ROUTE_FILE }; /* -n: calls of a run */
+  int i;
+
+  benchOptions(argc,argv,&o.calls,"");
+  mirrorStdout(FALSE);
+  for (i = 0; i < (int) (sizeof(routes) / sizeof(routes[0])); i++)
+  { o.route = routes[i].route;
+    routeStage(LEX,o.route);
+    benchRun(routes[i].name,printAll,&o,"calls");
+  }
+  unlink("/tmp/bench_log_lex.txt");
+  return 0;
+}
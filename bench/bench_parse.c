@@ -0,0 +1,57 @@
+/****************************************************/
+/* File: bench_parse.c                              */
+/* Parser throughput: parse() over a source in      */
+/* memory, in syntax tree nodes per second          */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "diag.h"
+#include "bench.h"
+
+typedef struct
+{ char * text;
+  size_t len;
+} Input;
+
+/* one run: the tree of the source, counted and freed */
+static double parseAll(void * data)
+{ Input * in = (Input *) data;
+  TreeNode * tree, * t;
+  long nodes = 0;
+  source = fmemopen(in->text,in->len,"r");
+  redundant_source = fmemopen(in->text,in->len,"r");
+  Error = FALSE;
+  resetScanner();
+  diagReset();
+  freeScopeArena();
+  tree = parse();
+  for (t = tree; t != NULL; t = t->sibling)
+    nodes += countNodes(t);
+  freeTree(tree);
+  fclose(source);
+  fclose(redundant_source);
+  return nodes;
+}
+
+int main(int argc, char * argv[])
+{ long functions = 2000; /* -n: of the generated source */
+  Input in;
+  int first = benchOptions(argc,argv,&functions,"[file.cm]");
+
+  if (first < argc) in.text = benchReadFile(argv[first],&in.len);
+  else in.text = benchSource(functions,&in.len);
+  /* no listing: only the parsing is timed */
+  EchoSource = TraceScan = TraceParse = FALSE;
+  mirrorStdout(FALSE);
+  initializePrinter("/tmp","bench_parse.cm",0);
+  listing = stdout;
+
+  printf("%s: %zu bytes\n",first < argc ? argv[first] : "generated source",in.len);
+  benchRun("parse",parseAll,&in,"nodes");
+  if (Error) printf("the source has syntax errors: the tree is partial\n");
+  free(in.text);
+  return 0;
+}
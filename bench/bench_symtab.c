@@ -0,0 +1,77 @@
+/****************************************************/
+/* File: bench_symtab.c                             */
+/* Symbol table (symtab.c): declarations and        */
+/* lookups per second at several table sizes        */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "bench.h"
+
+typedef struct
+{ char ** declared;
+  char ** undeclared;
+  long n;            /* names of each kind used */
+} Names;
+
+static void declareAll(Names * s)
+{ long i;
+  st_init();
+  for (i = 0; i < s->n; i++)
+    st_insert(s->declared[i],(int) (i % 1000) + 1,i % 4 ? "f" : "","var","int");
+}
+
+/* one run: a new table with every name declared */
+static double insertAll(void * data)
+{ Names * s = (Names *) data;
+  declareAll(s);
+  return s->n;
+}
+
+/* one run: every declared and undeclared name looked up from
+ * the scope f, so that the globals are found by the fallback
+ * to the global scope */
+static double lookupAll(void * data)
+{ Names * s = (Names *) data;
+  long i, found = 0;
+  for (i = 0; i < s->n; i++)
+  { found += st_lookup(s->declared[i],"f");
+    found += st_lookup(s->undeclared[i],"f");
+  }
+  if (found != s->n) fprintf(stderr,"st_lookup: %ld of %ld names found\n",found,s->n);
+  return 2 * s->n;
+}
+
+static char ** makeNames(const char * prefix, long n)
+{ char ** names = (char **) malloc(n * sizeof(char *));
+  char name[64];
+  long i;
+  for (i = 0; i < n; i++)
+  { snprintf(name,sizeof(name),"%s%ld",prefix,i);
+    names[i] = copyString(name);
+  }
+  return names;
+}
+
+int main(int argc, char * argv[])
+{ long largest = 32768; /* -n: names of the largest table */
+  Names s;
+  char label[64];
+
+  benchOptions(argc,argv,&largest,"");
+  mirrorStdout(FALSE);
+  initializePrinter("/tmp","bench_symtab.cm",0);
+  s.declared = makeNames("v",largest);
+  s.undeclared = makeNames("u",largest);
+  /* 1024, 8192, ... names, and the largest */
+  for (s.n = largest < 1024 ? largest : 1024; ; s.n = s.n * 8 < largest ? s.n * 8 : largest)
+  { snprintf(label,sizeof(label),"st_insert (%ld names)",s.n);
+    benchRun(label,insertAll,&s,"inserts");
+    declareAll(&s);
+    snprintf(label,sizeof(label),"st_lookup (%ld names)",s.n);
+    benchRun(label,lookupAll,&s,"lookups");
+    if (s.n == largest) break;
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+/****************************************************/
+/* File: bench_tm.c                                 */
+/* TM simulator (tm.c): instructions executed per   */
+/* second by stepTM on a loop of loads, stores,     */
+/* arithmetic and jumps                             */
+/****************************************************/
+
+/* the simulator as it is, with its main out of the way */
+#define main tmMain
+#include "../tm.c"
+#undef main
+
+#include "bench.h"
+
+/* counts r1 down from the constant of 0 to 0 (HALT is at 9) */
+static const char * loop =
+  "* bench_tm: a loop of 7 instructions\n"
+  "  0:    LDC  1,%ld(0)\n"
+  "  1:    LDC  2,1(0)\n"
+  "  2:    SUB  1,1,2\n"
+  "  3:     ST  1,5(0)\n"
+  "  4:     LD  3,5(0)\n"
+  "  5:    ADD  4,4,3\n"
+  "  6:    MUL  5,3,2\n"
+  "  7:    DIV  6,5,2\n"
+  "  8:    JGT  1,-7(7)\n"
+  "  9:   HALT  0,0,0\n";
+#define HALT_LOC 9
+
+/* one run: from the first instruction to HALT, which is not
+ * executed (it prints) */
+static double runLoop(void * data)
+{ long steps = 0;
+  int r;
+  (void) data;
+  for (r = 0; r < NO_REGS; r++) reg[r] = 0;
+  while (reg[PC_REG] != HALT_LOC)
+  { if (stepTM() != srOKAY)
+    { fprintf(stderr,"bench_tm: the simulator stopped at %d\n",reg[PC_REG] - 1);
+      exit(1);
+    }
+    steps++;
+  }
+  return steps;
+}
+
+int main(int argc, char * argv[])
+{ long iterations = 1000000; /* -n: of the loop */
+  char text[1024];
+
+  benchOptions(argc,argv,&iterations,"");
+  snprintf(text,sizeof(text),loop,iterations);
+  pgm = fmemopen(text,strlen(text),"r");
+  if (! readInstructions())
+    return 1;
+  fclose(pgm);
+  benchRun("stepTM",runLoop,NULL,"instructions");
+  return 0;
+}
@@ -0,0 +1,124 @@
+/****************************************************/
+/* File: cst_bench.c                                */
+/* Contention benchmark for the concurrent symbol   */
+/* table (cst.c): threads share the global scope    */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "cst.h"
+
+static int numNames = 4096;     /* -n: distinct global names */
+static long opsPerThread = 50000; /* -o */
+static int lookupPercent = 90;  /* -l: the rest are inserts */
+
+static char ** names;
+static pthread_barrier_t start;
+
+typedef struct
+{ int id;
+  double seconds;
+} Worker;
+
+static double now(void)
+{ struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* each thread is one analysis unit: it looks names up from its
+ * own function scope (falling back to the global scope), records
+ * uses of globals and declares a few globals of its own */
+static void * work(void * arg)
+{ Worker * w = (Worker *) arg;
+  unsigned int seed = 12345u + w->id;
+  char scope[32];
+  long i;
+  double t0;
+
+  snprintf(scope,sizeof(scope),"f%d",w->id);
+  cst_setUnit(w->id + 1);
+  pthread_barrier_wait(&start);
+  t0 = now();
+  for (i = 0; i < opsPerThread; i++)
+  { const char * name = names[rand_r(&seed) % numNames];
+    int r = rand_r(&seed) % 100;
+    if (r < lookupPercent)
+      cst_lookup(name,scope);
+    else if (r < lookupPercent + (100 - lookupPercent) / 2)
+      cst_insert(name,(int)(i % 64) + 1,"",NULL,NULL);
+    else
+      cst_insert(name,(int)(i % 64) + 1,scope,"var","int");
+  }
+  w->seconds = now() - t0;
+  return NULL;
+}
+
+static double run(int threads, int shards)
+{ pthread_t tid[64];
+  Worker w[64];
+  double slowest = 0;
+  int i;
+
+  cst_init(shards);
+  /* half of the names start declared in the global scope */
+  cst_setUnit(0);
+  for (i = 0; i < numNames; i += 2)
+    cst_insert(names[i],1,"","var","int");
+
+  pthread_barrier_init(&start,NULL,threads);
+  for (i = 0; i < threads; i++)
+  { w[i].id = i;
+    pthread_create(&tid[i],NULL,work,&w[i]);
+  }
+  for (i = 0; i < threads; i++)
+  { pthread_join(tid[i],NULL);
+    if (w[i].seconds > slowest) slowest = w[i].seconds;
+  }
+  pthread_barrier_destroy(&start);
+  cst_merge();
+  return threads * opsPerThread / slowest / 1e6;
+}
+
+static void usage(const char * prog)
+{ fprintf(stderr,"usage: %s [-n names] [-o ops per thread] [-l lookup percent]\n",prog);
+  exit(1);
+}
+
+int main(int argc, char * argv[])
+{ static const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+  int i;
+
+  for (i = 1; i < argc; i++)
+  { if (i + 1 >= argc) usage(argv[0]);
+    if (strcmp(argv[i],"-n") == 0) numNames = atoi(argv[++i]);
+    else if (strcmp(argv[i],"-o") == 0) opsPerThread = atol(argv[++i]);
+    else if (strcmp(argv[i],"-l") == 0) lookupPercent = atoi(argv[++i]);
+    else usage(argv[0]);
+  }
+  if (numNames < 1 || opsPerThread < 1 || lookupPercent < 0 || lookupPercent > 100)
+    usage(argv[0]);
+
+  names = (char **) malloc(numNames * sizeof(char *));
+  for (i = 0; i < numNames; i++)
+  { names[i] = (char *) malloc(16);
+    snprintf(names[i],16,"g%d",i);
+  }
+
+  printf("%d names, %ld ops/thread, %d%% lookups (Mops/s)\n\n",
+         numNames,opsPerThread,lookupPercent);
+  printf("threads  1 shard  64 shards  speedup\n");
+  printf("-------  -------  ---------  -------\n");
+  for (i = 0; i < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); i++)
+  { int t = threadCounts[i];
+    double one = run(t,1);
+    double many = run(t,64);
+    printf("%7d  %7.2f  %9.2f  %6.2fx\n",t,one,many,many / one);
+  }
+  cst_free();
+  return 0;
+}
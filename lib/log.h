@@ -1,9 +1,13 @@
 #ifndef VARIABLEPRINTER_H
 #define VARIABLEPRINTER_H
 
+#include <stddef.h>
+
 
 /// bitmask to select output files
 typedef enum fileDestination {
+    /// no file: with pp, prints only on stdout
+    OUT = 0x0,
     /// NOT STDERR!!! JUST A FILE TO STORE YOUR ERR MSGS!!
     ER_ = 0x1, 
     /// lexical 
@@ -30,8 +34,48 @@ typedef enum fileDestination {
     LOGALL = 0x1F, 
 } FileDestination; 
 
-void initializePrinter(const char *path, const char* baseName, FileDestination files2open) ;
+/// where the text of a stage goes (see routeStage)
+typedef enum sinkRoute {
+    /// the stage file (default)
+    ROUTE_FILE = 0,
+    /// stdout instead of the file
+    ROUTE_STDOUT,
+    /// a buffer in memory, handed back by takeStageBuffer
+    ROUTE_MEMORY,
+    /// nowhere
+    ROUTE_DISCARD,
+    /// a function, set by hookStage
+    ROUTE_HOOK,
+} SinkRoute;
+
+/// receives the text of a stage routed by hookStage
+typedef void (*SinkHook)(FileDestination stage, const char *text, size_t len, void *data);
+
+/// bit of stdout in liveOutputs (above every FileDestination)
+#define LOG_STDOUT 0x20
+
+/// stages (and LOG_STDOUT) whose text currently goes somewhere; kept up to date by log.c
+extern unsigned liveOutputs;
+extern FileDestination currentState;
+extern FileDestination filesOpened;
+
+/// true if text sent to destination (with the stdout copy of pc/pp) would be output
+#define logLive(destination) (liveOutputs & ((destination) | LOG_STDOUT))
+
+/**
+ * guard of a trace listing: level is a runtime switch (TraceScan, TraceParse, ...).
+ * Nothing is evaluated nor formatted unless the level is on and pc() output
+ * goes somewhere. Building with NO_TRACE compiles the listings out.
+ */
+#ifdef NO_TRACE
+#define TRACE_ON(level) 0
+#else
+#define TRACE_ON(level) ((level) && logLive(currentState))
+#endif
+
+int initializePrinter(const char *path, const char* baseName, FileDestination files2open) ;
 void pp(FileDestination destination, const char* format, ...);
+void pf(FileDestination destination, const char* format, ...);
 void doneLEXstartSYN() ;
 void doneSYNstartTAB() ;
 void doneTABstartGEN() ;
@@ -40,5 +84,14 @@ void pce(const char* format, ...) ;
 void fflushc();
 
 void closePrinter();
+FileDestination filesWritten(void);
+
+void routeStage(FileDestination stages, SinkRoute route);
+void hookStage(FileDestination stages, SinkHook hook, void *data);
+void mirrorStdout(int on);
+void onlyStdout(int on);
+size_t outputBytes(void);
+void asyncWriter(int on);
+char *takeStageBuffer(FileDestination stage, size_t *len);
 
 #endif  // VARIABLEPRINTER_H
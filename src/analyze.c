@@ -1,6 +1,6 @@
 /****************************************************/
 /* File: analyze.c                                  */
-/* Implementação da análise semântica em DUAS PASSADAS
+/* Implementação da análise semântica em UMA PASSADA
  * e exibição da tabela de símbolos no compilador C-
  ****************************************************/
 
@@ -8,12 +8,16 @@
  #include <stdlib.h>
  #include <string.h>
  #include <stddef.h> /* adicionado */
+ #include <pthread.h>
  
  #include "analyze.h"
  #include "globals.h"
  #include "symtab.h"
+ #include "callgraph.h"
+ #include "diag.h"
  #include "util.h"
  #include "log.h"  /* pc(...), pce(...) */
+ #include "phase.h" /* --trace-events */
  
  /* Contador de erros semânticos */
  static int semanticErrors = 0;
@@ -21,23 +25,376 @@
  /* Indica se encontramos "main" em alguma definição de função */
  static int foundMain = 0;
  
- /* Escopo atual (ex: "main", "", "f", etc.) */
- static char currentScopeName[50] = "";
+ /* Escopo atual (ex: "main", "", "f", etc.); cada thread da
+    análise paralela tem o seu */
+ static _Thread_local const char *currentScopeName = "";
+ 
+ /*--------------------------------------------------*/
+ /* Erros semânticos ficam guardados durante a       */
+ /* passada única e entregues ao diag.h em dois      */
+ /* lotes: declarações e usos (antes da TS) e tipos  */
+ /* (depois da TS).                                  */
+ /*--------------------------------------------------*/
+ typedef struct semErrorRec
+ {
+     int lineno;
+     DiagCode code;
+     const char *id;
+     /* chamada a função ainda não declarada: só vira erro
+        se a função não for declarada até o fim */
+     int pending;
+     struct semErrorRec *next;
+ } SemError;
+ 
+ typedef struct
+ {
+     SemError *head, *tail;
+ } SemErrorList;
+ 
+ static SemErrorList declErrors, useErrors, typeErrors;
+ 
+ /* Chamadas a funções definidas mais adiante: as linhas são
+    inseridas na TS quando a função for declarada. Ficam numa
+    hash por nome, cada nome com suas chamadas em ordem. */
+ #define PENDING_SIZE 211
+ 
+ typedef struct pendingLineRec
+ {
+     int lineno;
+     SemError *useError;   /* "not declared" se nunca for declarada */
+     struct pendingLineRec *next;
+ } PendingLine;
+ 
+ typedef struct pendingCallRec
+ {
+     char *name;
+     PendingLine *head, *tail;
+     struct pendingCallRec *next;
+ } PendingCall;
+ 
+ static PendingCall *pendingCalls[PENDING_SIZE];
+ 
+ static int pendingHash(const char *key)
+ {
+     unsigned int temp = 0;
+     for (int i = 0; key[i] != '\0'; i++)
+         temp = ((temp << 4) + key[i]) % PENDING_SIZE;
+     return temp;
+ }
  
  /*--------------------------------------------------*/
  /* Função auxiliar para reportar erro semântico     */
  /*--------------------------------------------------*/
- static void semanticError(int lineno, const char *msgFormat, const char *id)
+ static void semanticError(int lineno, DiagCode code, const char *id)
  {
-     pce("Semantic error at line %d: ", lineno);
-     pce(msgFormat, id);
-     pce("\n");
+     diagReport(DIAG_ERROR, lineno, code, id);
      semanticErrors++;
  }
  
+ /* Guarda um erro para impressão posterior */
+ static SemError *deferError(SemErrorList *list, int lineno,
+                             DiagCode code, const char *id, int pending)
+ {
+     SemError *e = (SemError *)malloc(sizeof(*e));
+     e->lineno    = lineno;
+     e->code      = code;
+     e->id        = id;
+     e->pending   = pending;
+     e->next      = NULL;
+     if (list->tail == NULL)
+         list->head = e;
+     else
+         list->tail->next = e;
+     list->tail = e;
+     return e;
+ }
+ 
+ /* Imprime (e esvazia) uma lista de erros; os pendentes só são
+    impressos se 'stillMissing' disser que o nome não foi resolvido */
+ static void flushErrors(SemErrorList *list, int (*stillMissing)(SemError *))
+ {
+     SemError *e = list->head;
+     while (e != NULL)
+     {
+         SemError *next = e->next;
+         if (!e->pending || stillMissing(e))
+             semanticError(e->lineno, e->code, e->id);
+         free(e);
+         e = next;
+     }
+     list->head = list->tail = NULL;
+ }
+ 
+ /* Chamada pendente que nenhuma declaração global resolveu */
+ static int callNeverDeclared(SemError *e)
+ {
+     return e->pending > 0;
+ }
+ 
+ /* Chamada pendente a função que acabou sendo void */
+ static int callReturnsVoid(SemError *e)
+ {
+     char *retType = st_dataType(e->id, "");
+     return retType != NULL && strcmp(retType, "void") == 0;
+ }
+ 
+ /* Guarda uma chamada a 'name' ainda não declarado */
+ static void addPendingCall(char *name, int lineno, SemError *useError)
+ {
+     int h = pendingHash(name);
+     PendingCall *c = pendingCalls[h];
+     PendingLine *l = (PendingLine *)malloc(sizeof(*l));
+ 
+     while (c != NULL && strcmp(c->name, name) != 0)
+         c = c->next;
+     if (c == NULL)
+     {
+         c = (PendingCall *)malloc(sizeof(*c));
+         c->name = name;
+         c->head = c->tail = NULL;
+         c->next = pendingCalls[h];
+         pendingCalls[h] = c;
+     }
+     l->lineno   = lineno;
+     l->useError = useError;
+     l->next     = NULL;
+     if (c->tail == NULL)
+         c->head = l;
+     else
+         c->tail->next = l;
+     c->tail = l;
+ }
+ 
+ /* Declaração global de 'name': resolve as chamadas pendentes
+    a esse nome, na ordem em que apareceram */
+ static void resolvePendingCalls(const char *name)
+ {
+     int h = pendingHash(name);
+     PendingCall **link = &pendingCalls[h];
+ 
+     while (*link != NULL && strcmp((*link)->name, name) != 0)
+         link = &(*link)->next;
+     if (*link == NULL)
+         return;
+ 
+     PendingCall *c = *link;
+     *link = c->next;
+     for (PendingLine *l = c->head; l != NULL; )
+     {
+         PendingLine *next = l->next;
+         st_insert(c->name, l->lineno, "", NULL, NULL);
+         l->useError->pending = -1; /* resolvida: não é erro */
+         free(l);
+         l = next;
+     }
+     free(c);
+ }
+ 
+ /* Descarta as chamadas que nunca foram resolvidas (os erros
+    delas continuam pendentes em useErrors) */
+ static void dropPendingCalls(void)
+ {
+     for (int h = 0; h < PENDING_SIZE; h++)
+     {
+         while (pendingCalls[h] != NULL)
+         {
+             PendingCall *c = pendingCalls[h];
+             pendingCalls[h] = c->next;
+             for (PendingLine *l = c->head; l != NULL; )
+             {
+                 PendingLine *next = l->next;
+                 free(l);
+                 l = next;
+             }
+             free(c);
+         }
+     }
+ }
+ 
+ /*--------------------------------------------------*/
+ /* Análise paralela (setAnalysisJobs > 1): depois   */
+ /* das declarações de topo, cada thread analisa     */
+ /* corpos de função sem tocar a TS nem as listas de */
+ /* erro. Os efeitos ficam num log por função e são  */
+ /* reaplicados em ordem de fonte, reproduzindo a    */
+ /* execução serial.                                 */
+ /*--------------------------------------------------*/
+ typedef enum { EV_DECL, EV_USE, EV_ERROR, EV_PENDING_CALL, EV_CALL } EventKind;
+ 
+ typedef struct
+ {
+     EventKind kind;
+     int lineno;
+     char *name;             /* símbolo (ou id do erro) */
+     const char *scope;      /* EV_DECL, EV_USE; quem chama em EV_CALL */
+     const char *idType;     /* EV_DECL */
+     const char *dataType;   /* EV_DECL */
+     SemErrorList *list;     /* EV_ERROR */
+     DiagCode code;          /* EV_ERROR */
+     int pending;            /* EV_ERROR */
+ } Event;
+ 
+ typedef struct
+ {
+     Event *events;
+     int n, cap;
+ } EventLog;
+ 
+ /* Símbolos locais da função em análise, vistos só pela thread */
+ #define LOCAL_SIZE PENDING_SIZE /* mesmo hash das chamadas pendentes */
+ 
+ typedef struct localSymRec
+ {
+     char *name;
+     struct localSymRec *next;
+ } LocalSym;
+ 
+ typedef struct
+ {
+     EventLog *log;        /* efeitos da função em análise */
+     int visibleGlobals;   /* símbolos da TS com st_order menor são visíveis */
+     LocalSym *locals[LOCAL_SIZE];
+ } WorkerContext;
+ 
+ /* NULL na análise serial (e na thread principal) */
+ static _Thread_local WorkerContext *worker = NULL;
+ 
+ static Event *logEvent(EventKind kind, int lineno, char *name)
+ {
+     EventLog *log = worker->log;
+     if (log->n == log->cap)
+     {
+         log->cap = log->cap ? 2 * log->cap : 64;
+         log->events = (Event *)realloc(log->events, log->cap * sizeof(Event));
+     }
+     Event *e = &log->events[log->n++];
+     memset(e, 0, sizeof(*e));
+     e->kind   = kind;
+     e->lineno = lineno;
+     e->name   = name;
+     return e;
+ }
+ 
+ static LocalSym **findLocal(const char *name)
+ {
+     LocalSym **link = &worker->locals[pendingHash(name)];
+     while (*link != NULL && strcmp((*link)->name, name) != 0)
+         link = &(*link)->next;
+     return link;
+ }
+ 
+ /* st_lookup_local visto pela análise: numa thread, o escopo
+    global só tem o que foi declarado antes da função e o escopo
+    da função é a tabela local da thread */
+ static int lookupLocal(const char *name, const char *scope)
+ {
+     if (worker == NULL)
+         return st_lookup_local(name, scope);
+     if (scope[0] == '\0')
+     {
+         int order = st_order(name, "");
+         return order >= 0 && order < worker->visibleGlobals;
+     }
+     return *findLocal(name) != NULL;
+ }
+ 
+ /* Declara no escopo atual; 1 se for redeclaração */
+ static int insertDecl(char *name, int lineno, const char *idType, const char *dataType)
+ {
+     if (worker == NULL)
+         return st_insert(name, lineno, currentScopeName, idType, dataType);
+ 
+     LocalSym **link = findLocal(name);
+     if (*link != NULL)
+         return 1;
+     *link = (LocalSym *)malloc(sizeof(LocalSym));
+     (*link)->name = name;
+     (*link)->next = NULL;
+ 
+     Event *e = logEvent(EV_DECL, lineno, name);
+     e->scope    = currentScopeName;
+     e->idType   = idType;
+     e->dataType = dataType;
+     return 0;
+ }
+ 
+ /* Registra uma linha de uso de (name, scope) */
+ static void insertUse(char *name, int lineno, const char *scope)
+ {
+     if (worker == NULL)
+         st_insert(name, lineno, scope, NULL, NULL);
+     else
+         logEvent(EV_USE, lineno, name)->scope = scope;
+ }
+ 
+ static void recordError(SemErrorList *list, int lineno,
+                         DiagCode code, char *id, int pending)
+ {
+     if (worker == NULL)
+         deferError(list, lineno, code, id, pending);
+     else
+     {
+         Event *e = logEvent(EV_ERROR, lineno, id);
+         e->list      = list;
+         e->code      = code;
+         e->pending   = pending;
+     }
+ }
+ 
+ /* Chamada a função ainda não declarada */
+ static void recordPendingCall(char *name, int lineno)
+ {
+     if (worker == NULL)
+         addPendingCall(name, lineno,
+                        deferError(&useErrors, lineno,
+                                   DIAG_UNDECLARED, name, 1));
+     else
+         logEvent(EV_PENDING_CALL, lineno, name);
+ }
+ 
+ /* Aresta do grafo de chamadas: a função atual chama name */
+ static void recordCall(char *name, int lineno)
+ {
+     if (worker == NULL)
+         cgAddCall(currentScopeName, name, lineno);
+     else
+         logEvent(EV_CALL, lineno, name)->scope = currentScopeName;
+ }
+ 
+ /* Reaplica (na thread principal) os efeitos de uma função */
+ static void replayLog(EventLog *log)
+ {
+     for (int i = 0; i < log->n; i++)
+     {
+         Event *e = &log->events[i];
+         switch (e->kind)
+         {
+             case EV_DECL:
+                 st_insert(e->name, e->lineno, e->scope, e->idType, e->dataType);
+                 break;
+             case EV_USE:
+                 st_insert(e->name, e->lineno, e->scope, NULL, NULL);
+                 break;
+             case EV_ERROR:
+                 deferError(e->list, e->lineno, e->code, e->name, e->pending);
+                 break;
+             case EV_PENDING_CALL:
+                 recordPendingCall(e->name, e->lineno);
+                 break;
+             case EV_CALL:
+                 cgAddCall(e->scope, e->name, e->lineno);
+                 break;
+         }
+     }
+     free(log->events);
+     log->events = NULL;
+     log->n = log->cap = 0;
+ }
+ 
  /*--------------------------------------------------*/
  /* Insere as funções built-in "input" e "output"    */
  /* na tabela de símbolos, com lineno=0 (sem linhas) */
+ /* e recomeça o grafo de chamadas com elas          */
  /*--------------------------------------------------*/
  static void insertBuiltIns(void)
  {
@@ -46,284 +403,471 @@
  
      /* output() => retorna void, scope="", idType="fun" */
      st_insert("output", 0, "", "fun", "void");
+ 
+     /* no grafo de chamadas, linha 0 => built-in */
+     cgReset();
+     cgAddFunction("input", 0);
+     cgAddFunction("output", 0);
+ }
+ 
+ /* 1 se t é IdK declarado (pai TypeK) */
+ static int isDeclaration(TreeNode *t)
+ {
+     return t->parent && t->parent->nodekind == TypeK;
  }
  
  /*--------------------------------------------------*/
- /* Passada 1: Insere apenas as DECLARAÇÕES          */
+ /* Declaração de função: insere no escopo global e  */
+ /* passa a usar o nome dela como escopo             */
  /*--------------------------------------------------*/
- static void insertDecl_pre(TreeNode *t)
+ static void declareFunction(TreeNode *t)
  {
-     if (t == NULL) return;
+     char *name = t->attr.name;
  
-     if (t->nodekind == IdK)
-     {
-         /* Exemplo: se for Function => pai é TypeK => DECLARAÇÃO de função */
-         if (t->kind.id == Function)
-         {
-             if (t->parent && t->parent->nodekind == TypeK)
-             {
-                 char *name = t->attr.name;
+     /* Se o TypeK do pai é int ou void */
+     char *dataType = (t->parent->kind.type == Void) ? "void" : "int";
  
-                 /* Se o TypeK do pai é int ou void */
-                 char *dataType = (t->parent->kind.type == Void) ? "void" : "int";
+     /* Escopo global = "" */
+     st_insert(name, t->lineno, "", "fun", dataType);
+     resolvePendingCalls(name);
+     cgAddFunction(name, t->lineno);
  
-                 /* Escopo global = "" */
-                 st_insert(name, t->lineno, "", "fun", dataType);
+     if (!strcmp(name, "main"))
+         foundMain = 1;
  
-                 if (!strcmp(name, "main"))
-                     foundMain = 1;
+     /* Muda escopo para o nome da função */
+     currentScopeName = name;
+ }
  
-                 /* Muda escopo para o nome da função */
-                 strcpy(currentScopeName, name);
-             }
-         }
-         /* Se for Variable ou Array => DECLARAÇÃO de variável/array */
-         else if (t->kind.id == Variable || t->kind.id == Array)
-         {
-             /* Só é declaração se o pai for TypeK */
-             if (t->parent && t->parent->nodekind == TypeK)
-             {
-                 char *name = t->attr.name;
-                 char *dataType = (t->parent->kind.type == Void) ? "void" : "int";
-                 char *idType   = (t->kind.id == Variable) ? "var" : "array";
- 
-                 if (strcmp(dataType, "void") == 0) {
-                     semanticError(t->lineno, "variable declared void", name);
-                     return; 
-                 }
- 
-                 /* Verifica se já existe função global com esse nome */
-                 if (st_lookup_local(name, "")) {
-                     char symbolType[10];
-                     strncpy(symbolType, st_symbolType(name, ""), sizeof(symbolType)-1);
-                     symbolType[sizeof(symbolType)-1] = 0; 
-                     if (symbolType[0] != '\0' && strcmp(symbolType, "fun") == 0) {
-                         semanticError(t->lineno, "'%s' was already declared as a function", name);
-                         return; // Evita inserir
-                     }
-                 }
- 
-                 /* Insere no escopo atual (ex: nome da função) */
-                 if (st_insert(name, t->lineno, currentScopeName, idType, dataType)) {
-                     /* Se retornar 1 => redeclaração no mesmo escopo */
-                     semanticError(t->lineno, "'%s' was already declared as a variable", name);
-                 }
-             }
+ /*--------------------------------------------------*/
+ /* Declaração de variável/array no escopo atual     */
+ /*--------------------------------------------------*/
+ static void declareVariable(TreeNode *t)
+ {
+     char *name = t->attr.name;
+     char *dataType = (t->parent->kind.type == Void) ? "void" : "int";
+     char *idType   = (t->kind.id == Variable) ? "var" : "array";
+ 
+     if (strcmp(dataType, "void") == 0) {
+         recordError(&declErrors, t->lineno, DIAG_VOID_VARIABLE, name, 0);
+         return; 
+     }
+ 
+     /* Verifica se já existe função global com esse nome */
+     if (lookupLocal(name, "")) {
+         char symbolType[10];
+         strncpy(symbolType, st_symbolType(name, ""), sizeof(symbolType)-1);
+         symbolType[sizeof(symbolType)-1] = 0; 
+         if (symbolType[0] != '\0' && strcmp(symbolType, "fun") == 0) {
+             recordError(&declErrors, t->lineno, DIAG_REDECL_FUNCTION, name, 0);
+             return; // Evita inserir
          }
      }
+ 
+     /* Insere no escopo atual (ex: nome da função) */
+     if (insertDecl(name, t->lineno, idType, dataType)) {
+         /* Se retornar 1 => redeclaração no mesmo escopo */
+         recordError(&declErrors, t->lineno, DIAG_REDECL_VARIABLE, name, 0);
+     }
+     else if (currentScopeName[0] == '\0')
+         resolvePendingCalls(name);
  }
  
- /* Ao sair de um nó: se for Function (e de fato definido), restauramos escopo="" */
- static void insertDecl_post(TreeNode *t)
+ /*--------------------------------------------------*/
+ /* Uso de variável, array ou chamada de função:     */
+ /* procura no escopo atual e depois no global.      */
+ /* Como em C- tudo é declarado antes do uso, só as  */
+ /* chamadas a funções definidas adiante esperam.    */
+ /*--------------------------------------------------*/
+ static void resolveUse(TreeNode *t, int isCall)
  {
-     if (t == NULL) return;
+     char *name = t->attr.name;
+     int foundLocal  = lookupLocal(name, currentScopeName);
+     int foundGlobal = lookupLocal(name, "");
  
-     if (t->nodekind == IdK && t->kind.id == Function)
+     if (isCall)
+         recordCall(name, t->lineno);
+ 
+     if (!foundLocal && !foundGlobal)
      {
-         /* terminou corpo da função => volta para escopo global,
-          * mas só se este IdK realmente era declaração */
-         if (t->parent && t->parent->nodekind == TypeK)
-         {
-             strcpy(currentScopeName, "");
-         }
+         if (isCall)
+             recordPendingCall(name, t->lineno);
+         else
+             recordError(&useErrors, t->lineno, DIAG_UNDECLARED, name, 0);
+     }
+     else
+     {
+         if (foundLocal)
+             insertUse(name, t->lineno, currentScopeName);
+         else
+             insertUse(name, t->lineno, "");
      }
  }
  
  /*--------------------------------------------------*/
- /* Passada 2: Insere USOS e checa se declarados     */
+ /* Passada única, pré-ordem: declarações e usos     */
  /*--------------------------------------------------*/
- static void insertUse_pre(TreeNode *t)
+ static void analyze_pre(TreeNode *t)
  {
      if (t == NULL) return;
      if (t->nodekind != IdK) return;
  
-     /* 1) Se for Function + pai TypeK => é a DEF de função (já inserida) */
-     if (t->kind.id == Function && t->parent && t->parent->nodekind == TypeK)
+     if (t->kind.id == Function)
      {
-         strcpy(currentScopeName, t->attr.name);
-         return;
+         if (isDeclaration(t))
+             declareFunction(t);
+         else
+             /* pai NÃO é TypeK => chamada de função */
+             resolveUse(t, 1);
      }
- 
-     /* 2) Se for FunctionCall => uso de função */
-     if (t->kind.id == FunctionCall)
+     /* Se for Variable ou Array => declaração (pai TypeK) ou uso */
+     else if (t->kind.id == Variable || t->kind.id == Array)
      {
-         char *name = t->attr.name;
-         int foundLocal  = st_lookup_local(name, currentScopeName);
-         int foundGlobal = st_lookup_local(name, "");
- 
-         if (!foundLocal && !foundGlobal)
-         {
-             semanticError(t->lineno, "'%s' was not declared in this scope", name);
-         }
+         if (isDeclaration(t))
+             declareVariable(t);
          else
-         {
-             if (foundLocal)
-                 st_insert(name, t->lineno, currentScopeName, NULL, NULL);
-             else
-                 st_insert(name, t->lineno, "", NULL, NULL);
-         }
-         return;
+             resolveUse(t, 0);
      }
+ }
  
-     /* 3) Se for Variable ou Array => uso de variável (se pai NÃO for TypeK) */
-     if ((t->kind.id == Variable || t->kind.id == Array) &&
-         !(t->parent && t->parent->nodekind == TypeK))
-     {
-         char *name = t->attr.name;
-         int foundLocal  = st_lookup_local(name, currentScopeName);
-         int foundGlobal = st_lookup_local(name, "");
+ /*--------------------------------------------------*/
+ /* Passada única, pós-ordem: verificação de tipos e */
+ /* saída do escopo da função                        */
+ /*--------------------------------------------------*/
  
-         if (!foundLocal && !foundGlobal)
-         {
-             semanticError(t->lineno, "'%s' was not declared in this scope", name);
-         }
-         else
-         {
-             if (foundLocal)
-                 st_insert(name, t->lineno, currentScopeName, NULL, NULL);
-             else
-                 st_insert(name, t->lineno, "", NULL, NULL);
-         }
-         return;
-     }
+ /*
+    Exemplo de checagem para "invalid use of void expression":
  
-     /* 4) Caso o parser não separe FunctionCall de Function,
-        mas percebamos que é chamada => se nodekind=IdK + kind.id==Function
-        e pai NÃO é TypeK, é uso de função */
-     if (t->kind.id == Function && !(t->parent && t->parent->nodekind == TypeK))
+    Se a função é void, mas está sendo usada em um contexto 
+    que espera valor (por ex: a = funcVoid(); ), geramos erro.
+ */
+ static void checkNode(TreeNode *t)
+ {
+     /* Verifica se este nó é um Function usado como chamada
+        (pai não é TypeK). */
+     if (t->nodekind == IdK && t->kind.id == Function && !isDeclaration(t))
      {
-         char *name = t->attr.name;
-         int foundLocal  = st_lookup_local(name, currentScopeName);
-         int foundGlobal = st_lookup_local(name, "");
- 
-         if (!foundLocal && !foundGlobal)
+         /* Se o pai for algo que indica "uso em expressão" */
+         TreeNode *p = t->parent;
+         /*
+           Se o pai for IdK ou ExpK=Operator ou StmtK=Assign,
+           consideramos que está em contexto que espera valor.
+         */
+         if (p != NULL
+             && (p->nodekind == IdK
+                 || (p->nodekind == ExpK && p->kind.exp == Operator)
+                 || (p->nodekind == StmtK && p->kind.stmt == Assign)))
          {
-             semanticError(t->lineno, "'%s' was not declared in this scope", name);
-         }
-         else
-         {
-             if (foundLocal)
-                 st_insert(name, t->lineno, currentScopeName, NULL, NULL);
+             /* o tipo de retorno é o da função global; se ainda
+                não foi declarada, decide no fim */
+             if (!lookupLocal(t->attr.name, ""))
+                 recordError(&typeErrors, t->lineno, DIAG_VOID_USE, t->attr.name, 1);
              else
-                 st_insert(name, t->lineno, "", NULL, NULL);
+             {
+                 char *retType = st_dataType(t->attr.name, "");
+                 if (retType != NULL && strcmp(retType, "void") == 0)
+                     recordError(&typeErrors, t->lineno, DIAG_VOID_USE, t->attr.name, 0);
+             }
          }
      }
  }
  
- static void insertUse_post(TreeNode *t)
+ static void analyze_post(TreeNode *t)
  {
      if (t == NULL) return;
  
+     checkNode(t);
+ 
      /* Se for a definição de função (pai TypeK), saímos do escopo */
-     if (t->nodekind == IdK && t->kind.id == Function
-         && t->parent && t->parent->nodekind == TypeK)
+     if (t->nodekind == IdK && t->kind.id == Function && isDeclaration(t))
      {
-         strcpy(currentScopeName, "");
+         currentScopeName = "";
      }
  }
  
  /*--------------------------------------------------*/
  /* Percurso genérico na AST (preProc e postProc)    */
+ /* Os irmãos são percorridos em laço, para listas   */
+ /* longas não estourarem a pilha                    */
  /*--------------------------------------------------*/
  static void traverse(TreeNode *t,
                       void (*preProc)(TreeNode *),
-                      void (*postProc)(TreeNode *))
- {
-     if (t == NULL) return;
+                      void (*postProc)(TreeNode *));
  
+ /* Percorre t e seus filhos, mas não os irmãos de t */
+ static void traverseNode(TreeNode *t,
+                          void (*preProc)(TreeNode *),
+                          void (*postProc)(TreeNode *))
+ {
      preProc(t);
      for (int i = 0; i < MAXCHILDREN; i++)
          traverse(t->child[i], preProc, postProc);
      postProc(t);
+ }
  
-     traverse(t->sibling, preProc, postProc);
+ static void traverse(TreeNode *t,
+                      void (*preProc)(TreeNode *),
+                      void (*postProc)(TreeNode *))
+ {
+     for (; t != NULL; t = t->sibling)
+         traverseNode(t, preProc, postProc);
  }
  
- /* Nop */
- static void nullProc(TreeNode *t)
+ /* Com --trace-events: a mesma passada, com um intervalo no
+    trace para cada função */
+ static void traverseTraced(TreeNode *syntaxTree)
  {
-     (void)t;
+     for (TreeNode *t = syntaxTree; t != NULL; t = t->sibling)
+     {
+         TreeNode *id = t->child[0];
+         if (t->nodekind == TypeK && id != NULL && id->nodekind == IdK &&
+             id->kind.id == Function)
+         {
+             int nodes = countNodes(t);
+             double start = phaseSpanStart();
+             traverseNode(t, analyze_pre, analyze_post);
+             phaseSpan(id->attr.name, nodes, start);
+         }
+         else
+             traverseNode(t, analyze_pre, analyze_post);
+     }
  }
  
  /*--------------------------------------------------*/
- /* buildSymtab => 2 passadas + built-ins            */
+ /* Análise paralela dos corpos de função            */
  /*--------------------------------------------------*/
- void buildSymtab(TreeNode *syntaxTree)
+ static int analysisJobs = 1;
+ 
+ void setAnalysisJobs(int jobs)
  {
-     /* 0) Inicializa TS e insere funções nativas */
-     st_init();
-     insertBuiltIns();
+     analysisJobs = (jobs > 0) ? jobs : 1;
+ }
+ 
+ /* Uma declaração de topo */
+ typedef struct
+ {
+     TreeNode *top;        /* TypeK da declaração */
+     TreeNode *fun;        /* IdK, se for função */
+     int visibleGlobals;   /* st_count() logo depois de declará-la */
+     EventLog log;
+ } Unit;
+ 
+ /* Funções de mesmo nome compartilham o escopo, então vão para a
+    mesma tarefa e são analisadas em ordem pela mesma thread */
+ typedef struct
+ {
+     Unit **units;
+     int n, cap;
+ } Task;
  
-     /* 1) Primeira passada: só DECLARAÇÕES */
-     traverse(syntaxTree, insertDecl_pre, insertDecl_post);
+ static Task *tasks;
+ static int nTasks;
+ static int nextTask;
  
-     /* 2) Segunda passada: USOS (e valida declarações) */
-     traverse(syntaxTree, insertUse_pre, insertUse_post);
+ static void *analysisWorker(void *arg)
+ {
+     WorkerContext *ctx = (WorkerContext *)calloc(1, sizeof(WorkerContext));
+     (void)arg;
  
-     /* Se não achamos main, gera erro */
-     if (!foundMain)
+     for (;;)
      {
-         pce("Semantic error: undefined reference to 'main'\n");
-         semanticErrors++;
-     }
+         int k = __atomic_fetch_add(&nextTask, 1, __ATOMIC_RELAXED);
+         if (k >= nTasks) break;
  
-     /* Imprime a TS no final */
-     pc("\nSymbol table:\n\n");
-     printSymTab();
+         for (int i = 0; i < tasks[k].n; i++)
+         {
+             Unit *u = tasks[k].units[i];
+             ctx->log = &u->log;
+             ctx->visibleGlobals = u->visibleGlobals;
+             worker = ctx;
+             currentScopeName = u->fun->attr.name;
+             int nodes = phaseTracing() ? countNodes(u->top) : 0;
+             double start = phaseTracing() ? phaseSpanStart() : 0.0;
+             for (int c = 0; c < MAXCHILDREN; c++)
+                 traverse(u->fun->child[c], analyze_pre, analyze_post);
+             if (phaseTracing())
+                 phaseSpan(u->fun->attr.name, nodes, start);
+             currentScopeName = "";
+             worker = NULL;
+         }
+         for (int h = 0; h < LOCAL_SIZE; h++)
+         {
+             while (ctx->locals[h] != NULL)
+             {
+                 LocalSym *next = ctx->locals[h]->next;
+                 free(ctx->locals[h]);
+                 ctx->locals[h] = next;
+             }
+         }
+     }
+     free(ctx);
+     return NULL;
  }
  
- /*--------------------------------------------------*/
- /* Se quiser verificação de tipos, faça aqui        */
- /*--------------------------------------------------*/
- 
- /*
-    Exemplo de checagem para "invalid use of void expression":
- 
-    Se a função é void, mas está sendo usada em um contexto 
-    que espera valor (por ex: a = funcVoid(); ), geramos erro.
- */
- static void checkNode(TreeNode *t)
+ static void discardErrors(SemErrorList *list)
  {
-     /* Verifica se este nó é uma chamada (FunctionCall) OU 
-        é um Function usado como chamada (pai não é TypeK). */
-     if (t->nodekind == IdK)
+     while (list->head != NULL)
      {
-         int isFunctionCallNode =
-             (t->kind.id == FunctionCall)
-             || (t->kind.id == Function && !(t->parent && t->parent->nodekind == TypeK));
+         SemError *next = list->head->next;
+         free(list->head);
+         list->head = next;
+     }
+     list->tail = NULL;
+ }
  
-         if (isFunctionCallNode)
+ static void analyzeParallel(TreeNode *syntaxTree)
+ {
+     int nUnits = 0, u;
+     TreeNode *t;
+ 
+     for (t = syntaxTree; t != NULL; t = t->sibling)
+         nUnits++;
+     Unit *units = (Unit *)calloc(nUnits > 0 ? nUnits : 1, sizeof(Unit));
+ 
+     /* 1) Declarações de topo entram na TS, que as threads só leem.
+        Os erros delas são descartados: saem de novo no passo 3 */
+     int *taskOf = (int *)malloc((st_count() + nUnits) * sizeof(int));
+     for (u = 0; u < st_count() + nUnits; u++)
+         taskOf[u] = -1;
+     tasks = NULL;
+     nTasks = 0;
+     for (t = syntaxTree, u = 0; t != NULL; t = t->sibling, u++)
+     {
+         TreeNode *id = t->child[0];
+         units[u].top = t;
+         if (t->nodekind != TypeK || id == NULL || id->nodekind != IdK)
+             continue;
+         if (id->kind.id == Function)
          {
-             char *retType = st_dataType(t->attr.name, currentScopeName);
-             if (retType != NULL && strcmp(retType, "void") == 0)
+             declareFunction(id);
+             currentScopeName = "";
+             units[u].fun = id;
+             units[u].visibleGlobals = st_count();
+ 
+             /* chave do nome: posição do símbolo global da função */
+             int key = st_order(id->attr.name, "");
+             if (taskOf[key] < 0)
              {
-                 /* Se o pai for algo que indica "uso em expressão" */
-                 TreeNode *p = t->parent;
-                 if (p != NULL)
-                 {
-                     /*
-                       Se o pai for IdK ou ExpK=Operator ou StmtK=Assign,
-                       consideramos que está em contexto que espera valor.
-                     */
-                     if (p->nodekind == IdK
-                         || (p->nodekind == ExpK && p->kind.exp == Operator)
-                         || (p->nodekind == StmtK && p->kind.stmt == Assign))
-                     {
-                         semanticError(t->lineno, "invalid use of void expression", t->attr.name);
-                     }
-                 }
+                 tasks = (Task *)realloc(tasks, (nTasks + 1) * sizeof(Task));
+                 memset(&tasks[nTasks], 0, sizeof(Task));
+                 taskOf[key] = nTasks++;
              }
+             Task *task = &tasks[taskOf[key]];
+             if (task->n == task->cap)
+             {
+                 task->cap = task->cap ? 2 * task->cap : 2;
+                 task->units = (Unit **)realloc(task->units, task->cap * sizeof(Unit *));
+             }
+             task->units[task->n++] = &units[u];
+         }
+         else if (id->kind.id == Variable || id->kind.id == Array)
+             declareVariable(id);
+     }
+     free(taskOf);
+     discardErrors(&declErrors);
+ 
+     /* 2) Corpos de função nas threads */
+     int nThreads = (analysisJobs < nTasks) ? analysisJobs : nTasks;
+     pthread_t *threads = (pthread_t *)malloc((nThreads > 0 ? nThreads : 1) * sizeof(pthread_t));
+     int started = 0;
+     nextTask = 0;
+     for (; started < nThreads; started++)
+         if (pthread_create(&threads[started], NULL, analysisWorker, NULL) != 0)
+             break;
+     if (started == 0)
+         analysisWorker(NULL);
+     for (int i = 0; i < started; i++)
+         pthread_join(threads[i], NULL);
+     free(threads);
+ 
+     /* 3) Refaz a TS em ordem de fonte: declarações de topo pelo
+        caminho serial e corpos pelos logs das threads */
+     st_init();
+     insertBuiltIns();
+     for (u = 0; u < nUnits; u++)
+     {
+         if (units[u].fun != NULL)
+         {
+             analyze_pre(units[u].top);
+             analyze_pre(units[u].fun);
+             replayLog(&units[u].log);
+             analyze_post(units[u].fun);
+             analyze_post(units[u].top);
          }
+         else
+             traverseNode(units[u].top, analyze_pre, analyze_post);
+     }
+ 
+     for (int k = 0; k < nTasks; k++)
+         free(tasks[k].units);
+     free(tasks);
+     tasks = NULL;
+     nTasks = 0;
+     free(units);
+ }
+ 
+ /*--------------------------------------------------*/
+ /* buildSymtab => passada única + built-ins         */
+ /*--------------------------------------------------*/
+ void buildSymtab(TreeNode *syntaxTree)
+ {
+     /* 0) Inicializa TS e insere funções nativas; zera o que
+        sobrou do arquivo anterior (mycmcomp a.cm b.cm -d ...) */
+     semanticErrors = 0;
+     foundMain = 0;
+     discardErrors(&declErrors);
+     discardErrors(&useErrors);
+     discardErrors(&typeErrors);
+     st_init();
+     insertBuiltIns();
+ 
+     /* 1) Passada única: declarações, usos e tipos; com mais de
+        uma thread, os corpos de função são analisados em paralelo */
+     if (analysisJobs > 1)
+         analyzeParallel(syntaxTree);
+     else if (phaseTracing())
+         traverseTraced(syntaxTree);
+     else
+         traverse(syntaxTree, analyze_pre, analyze_post);
+ 
+     /* 2) Erros de declaração e de uso; chamadas ainda
+        pendentes são a funções nunca declaradas */
+     flushErrors(&declErrors, callNeverDeclared);
+     flushErrors(&useErrors, callNeverDeclared);
+     dropPendingCalls();
+     cgFinish();
+ 
+     /* Se não achamos main, gera erro */
+     if (!foundMain)
+     {
+         semanticError(0, DIAG_NO_MAIN, NULL);
+     }
+     diagFlush();
+ 
+     /* --max-errors: para antes da TS */
+     if (diagLimitReached())
+         return;
+ 
+     /* Imprime a TS no final (se a saída dela for a algum lugar) */
+     if (TRACE_ON(TRUE))
+     {
+         pc("\nSymbol table:\n\n");
+         printSymTab();
      }
  }
  
+ /*--------------------------------------------------*/
+ /* Verificação de tipos: já feita na passada única; */
+ /* aqui só imprime os erros, depois da TS           */
+ /*--------------------------------------------------*/
  void typeCheck(TreeNode *syntaxTree)
  {
-     traverse(syntaxTree, nullProc, checkNode);
+     (void)syntaxTree;
+     flushErrors(&typeErrors, callReturnsVoid);
+     diagFlush();
      /* Se quiser, pode imprimir total de erros no final, etc. */
      if (semanticErrors > 0)
      {
          // pce("Type check found %d semantic errors.\n", semanticErrors);
      }
  }
- 
\ No newline at end of file
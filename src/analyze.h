@@ -3,10 +3,15 @@
 
 #include "globals.h"
 
-/* Constroi a Tabela de Símbolos (2 passadas) */
+/* Constroi a Tabela de Símbolos e o grafo de chamadas
+   (callgraph.h) e verifica tipos (passada única) */
 void buildSymtab(TreeNode *syntaxTree);
 
-/* Verificação de tipos, se desejado */
+/* Imprime os erros de tipo (detectados em buildSymtab) */
 void typeCheck(TreeNode *syntaxTree);
 
+/* Número de threads para analisar os corpos de função (padrão 1,
+   serial); a saída é idêntica à da análise serial */
+void setAnalysisJobs(int jobs);
+
 #endif
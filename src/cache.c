@@ -0,0 +1,414 @@
+/****************************************************/
+/* File: cache.c                                    */
+/* Content-addressed cache of the compiler outputs  */
+/****************************************************/
+
+#define _GNU_SOURCE /* dl_iterate_phdr */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include "globals.h"
+#include "util.h"
+#include "cache.h"
+
+#define PATH_LEN 1024
+#define NSTAGES 5
+
+/* the suffixes log.c gives the stage files */
+static const struct { FileDestination stage; const char * suffix; } stageFiles[NSTAGES] =
+{ { ER_, "_err.txt" }, { LEX, "_lex.txt" }, { SYN, "_syn.txt" },
+  { TAB, "_tab.txt" }, { GEN, "_gen.tm" } };
+
+/* counters of the stats file */
+typedef enum { HITS, MISSES, STORES, EVICTIONS, ENTRIES, SIZE, NCOUNTERS } Counter;
+static const char * counterNames[NCOUNTERS] =
+{ "hits", "misses", "stores", "evictions", "entries", "size" };
+
+typedef unsigned __int128 Hash;
+
+static char * cacheDir = NULL;
+static long long maxSize;
+static long long runHits = 0, runMisses = 0;
+
+/* the miss being compiled */
+static int capturing = FALSE;
+static int savedStdout = -1;
+static char tmpDir[PATH_LEN], entryDir[PATH_LEN], detailDir[PATH_LEN], baseName[256];
+static FileDestination entryStages;
+
+/* FNV-1a, 128 bits */
+static void hashBytes(Hash * h, const void * data, size_t len)
+{ static const Hash prime = ((Hash) 1 << 88) + 0x13B;
+  const unsigned char * p = (const unsigned char *) data;
+  size_t i;
+  for (i = 0; i < len; i++)
+  { *h ^= p[i];
+    *h *= prime;
+  }
+}
+
+static void hashString(Hash * h, const char * s)
+{ hashBytes(h, s, strlen(s) + 1);
+}
+
+/* the build ID note of the compiler, found with dl_iterate_phdr */
+typedef struct { const unsigned char * id; size_t len; } BuildId;
+
+static int findBuildId(struct dl_phdr_info * info, size_t size, void * data)
+{ BuildId * b = (BuildId *) data;
+  int i;
+  (void) size;
+  for (i = 0; i < info->dlpi_phnum; i++)
+  { const ElfW(Phdr) * ph = &info->dlpi_phdr[i];
+    const char * p, * end;
+    if (ph->p_type != PT_NOTE) continue;
+    p = (const char *) (info->dlpi_addr + ph->p_vaddr);
+    end = p + ph->p_memsz;
+    while (p + sizeof(ElfW(Nhdr)) <= end)
+    { const ElfW(Nhdr) * n = (const ElfW(Nhdr) *) p;
+      const char * name = p + sizeof(ElfW(Nhdr));
+      const char * desc = name + ((n->n_namesz + 3) & ~3u);
+      if (n->n_type == NT_GNU_BUILD_ID && n->n_namesz == 4 && memcmp(name, "GNU", 4) == 0)
+      { b->id = (const unsigned char *) desc;
+        b->len = n->n_descsz;
+        return 1;
+      }
+      p = desc + ((n->n_descsz + 3) & ~3u);
+    }
+  }
+  return 1; /* the first object is the program */
+}
+
+/* the build of the compiler: its build ID, or else the bytes of
+ * the executable */
+static void hashCompiler(Hash * h)
+{ BuildId b = { NULL, 0 };
+  char buf[65536];
+  ssize_t n;
+  int fd;
+  dl_iterate_phdr(findBuildId, &b);
+  if (b.id != NULL)
+  { hashBytes(h, b.id, b.len);
+    return;
+  }
+  fd = open("/proc/self/exe", O_RDONLY);
+  if (fd < 0) return;
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    hashBytes(h, buf, n);
+  close(fd);
+}
+
+static long long fileSize(const char * path)
+{ struct stat st;
+  return stat(path, &st) == 0 ? (long long) st.st_size : -1;
+}
+
+/* copies src to a new dst: a reflink where the file system has
+ * them, the bytes otherwise */
+static int copyFile(const char * src, const char * dst)
+{ char buf[65536];
+  ssize_t n;
+  int ok = TRUE;
+  int in = open(src, O_RDONLY), out;
+  if (in < 0) return FALSE;
+  unlink(dst);
+  out = open(dst, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (out < 0)
+  { close(in);
+    return FALSE;
+  }
+  if (ioctl(out, FICLONE, in) != 0)
+    while ((n = read(in, buf, sizeof(buf))) > 0)
+      if (write(out, buf, n) != n) { ok = FALSE; break; }
+  close(in);
+  if (close(out) != 0) ok = FALSE;
+  return ok;
+}
+
+/* src as dst: a hard link, or a copy across file systems */
+static int placeFile(const char * src, const char * dst)
+{ unlink(dst);
+  return link(src, dst) == 0 || copyFile(src, dst);
+}
+
+/* writes the file to fd 1 */
+static void sendFile(const char * path)
+{ char buf[65536];
+  ssize_t n;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return;
+  fflush(stdout);
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    if (write(STDOUT_FILENO, buf, n) != n) break;
+  close(fd);
+}
+
+/* removes a directory of files; returns the bytes it had */
+static long long removeDir(const char * dir)
+{ char path[PATH_LEN];
+  struct dirent * d;
+  long long size = 0;
+  DIR * dp = opendir(dir);
+  if (dp == NULL) return 0;
+  while ((d = readdir(dp)) != NULL)
+  { long long n;
+    if (d->d_name[0] == '.') continue;
+    snprintf(path, sizeof(path), "%s/%s", dir, d->d_name);
+    n = fileSize(path);
+    if (n > 0) size += n;
+    unlink(path);
+  }
+  closedir(dp);
+  rmdir(dir);
+  return size;
+}
+
+typedef struct
+{ char path[PATH_LEN];
+  long long used;   /* nanoseconds */
+  long long size;
+} Entry;
+
+static int byUse(const void * a, const void * b)
+{ long long x = ((const Entry *) a)->used, y = ((const Entry *) b)->used;
+  return x < y ? -1 : x > y;
+}
+
+/* with the stats locked: counts every entry again and removes
+ * the least recently used down to 90% of the limit */
+static void evict(long long counters[NCOUNTERS])
+{ Entry * entries = NULL;
+  int n = 0, cap = 0, i, j;
+  long long total = 0;
+  char sub[PATH_LEN];
+  for (i = 0; i < 256; i++)
+  { struct dirent * d;
+    DIR * dp;
+    snprintf(sub, sizeof(sub), "%s/%02x", cacheDir, i);
+    if ((dp = opendir(sub)) == NULL) continue;
+    while ((d = readdir(dp)) != NULL)
+    { struct stat st;
+      Entry * e;
+      if (d->d_name[0] == '.') continue;
+      if (n == cap)
+      { cap = cap ? 2 * cap : 256;
+        entries = (Entry *) realloc(entries, cap * sizeof(Entry));
+      }
+      e = &entries[n];
+      j = snprintf(e->path, sizeof(e->path), "%s/%s", sub, d->d_name);
+      if (j < 0 || j >= (int) sizeof(e->path)) continue; /* not an entry of ours */
+      if (stat(e->path, &st) != 0) continue;
+      e->used = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+      e->size = 0;
+      for (j = 0; j <= NSTAGES; j++)
+      { char file[PATH_LEN + 16];
+        long long size;
+        snprintf(file, sizeof(file), "%s/%s", e->path, j < NSTAGES ? stageFiles[j].suffix + 1 : "stdout");
+        if ((size = fileSize(file)) > 0) e->size += size;
+      }
+      total += e->size;
+      n++;
+    }
+    closedir(dp);
+  }
+  qsort(entries, n, sizeof(Entry), byUse);
+  for (i = 0; i < n && total > maxSize / 10 * 9; i++)
+  { removeDir(entries[i].path);
+    total -= entries[i].size;
+    counters[EVICTIONS]++;
+  }
+  counters[ENTRIES] = n - i;
+  counters[SIZE] = total;
+  free(entries);
+}
+
+/* adds delta to the counters of the stats file, under its lock;
+ * evicts if the size goes over the limit */
+static void updateStats(const long long delta[NCOUNTERS], long long counters[NCOUNTERS])
+{ char path[PATH_LEN], text[512];
+  long long c[NCOUNTERS] = { 0 };
+  int fd, i, len = 0;
+  ssize_t n;
+  snprintf(path, sizeof(path), "%s/stats", cacheDir);
+  fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return;
+  flock(fd, LOCK_EX);
+  n = read(fd, text, sizeof(text) - 1);
+  if (n > 0)
+  { char * line;
+    text[n] = '\0';
+    for (line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n"))
+      for (i = 0; i < NCOUNTERS; i++)
+      { size_t k = strlen(counterNames[i]);
+        if (strncmp(line, counterNames[i], k) == 0 && line[k] == ' ')
+          c[i] = atoll(line + k + 1);
+      }
+  }
+  if (delta != NULL)
+  { for (i = 0; i < NCOUNTERS; i++) c[i] += delta[i];
+    if (c[SIZE] > maxSize) evict(c);
+    for (i = 0; i < NCOUNTERS; i++)
+      len += snprintf(text + len, sizeof(text) - len, "%s %lld\n", counterNames[i], c[i]);
+    if (ftruncate(fd, 0) != 0 || pwrite(fd, text, len, 0) != len)
+      perror(path);
+  }
+  if (counters != NULL) memcpy(counters, c, sizeof(c));
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+int cacheOpen(const char * dir, long long maxBytes)
+{ char path[PATH_LEN];
+  snprintf(path, sizeof(path), "%s/tmp", dir);
+  if ((mkdir(dir, 0755) != 0 && errno != EEXIST) || (mkdir(path, 0755) != 0 && errno != EEXIST))
+  { perror(dir);
+    return FALSE;
+  }
+  cacheDir = copyString((char *) dir);
+  maxSize = maxBytes;
+  return TRUE;
+}
+
+/* the key of pgm; FALSE if it cannot be read */
+static int hashSource(Hash * h, const char * pgm, const char * options, FileDestination stages)
+{ static int compilerHashed = FALSE;
+  static Hash compiler;
+  char buf[65536];
+  size_t n;
+  FILE * f = fopen(pgm, "rb");
+  if (f == NULL) return FALSE;
+  if (! compilerHashed)
+  { compiler = ((Hash) 0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL;
+    hashString(&compiler, "mycmcomp cache 1");
+    hashCompiler(&compiler);
+    compilerHashed = TRUE;
+  }
+  *h = compiler;
+  hashString(h, options);
+  hashString(h, pgm); /* stdout names it */
+  hashBytes(h, &stages, sizeof(stages));
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    hashBytes(h, buf, n);
+  fclose(f);
+  return TRUE;
+}
+
+int cacheLookup(const char * pgm, const char * options, FileDestination stages,
+                const char * detailpath)
+{ static int sequence = 0;
+  char path[PATH_LEN + 16], detail[PATH_LEN + 256];
+  const char * start, * dot;
+  Hash h;
+  int i, fd;
+
+  capturing = FALSE;
+  if (cacheDir == NULL || ! hashSource(&h, pgm, options, stages)) return FALSE;
+  snprintf(entryDir, sizeof(entryDir), "%s/%02x/%014llx%016llx", cacheDir,
+           (unsigned) (h >> 120), (unsigned long long) (h >> 64) & 0xFFFFFFFFFFFFFFULL,
+           (unsigned long long) h);
+  /* the base name as log.c makes it */
+  start = strrchr(pgm, '/') ? strrchr(pgm, '/') + 1 : pgm;
+  dot = strrchr(start, '.');
+  snprintf(baseName, sizeof(baseName), "%.*s", dot ? (int) (dot - start) : (int) strlen(start), start);
+  snprintf(detailDir, sizeof(detailDir), "%s", detailpath);
+  entryStages = stages;
+
+  snprintf(path, sizeof(path), "%s/stdout", entryDir);
+  if (access(path, R_OK) == 0)
+  { for (i = 0; i < NSTAGES; i++)
+    { if (!(stages & stageFiles[i].stage)) continue;
+      snprintf(path, sizeof(path), "%s/%s", entryDir, stageFiles[i].suffix + 1);
+      snprintf(detail, sizeof(detail), "%s/%s%s", detailDir, baseName, stageFiles[i].suffix);
+      if (access(path, R_OK) == 0 && ! placeFile(path, detail)) perror(detail);
+    }
+    snprintf(path, sizeof(path), "%s/stdout", entryDir);
+    sendFile(path);
+    utimensat(AT_FDCWD, entryDir, NULL, 0); /* used now, for the eviction */
+    runHits++;
+    { long long delta[NCOUNTERS] = { 0 };
+      delta[HITS] = 1;
+      updateStats(delta, NULL);
+    }
+    return TRUE;
+  }
+
+  /* a miss: the entry is made in tmp, then moved in place */
+  runMisses++;
+  snprintf(tmpDir, sizeof(tmpDir), "%s/tmp/%ld.%d", cacheDir, (long) getpid(), sequence++);
+  if (mkdir(tmpDir, 0755) != 0)
+  { perror(tmpDir);
+    return FALSE;
+  }
+  snprintf(path, sizeof(path), "%s/stdout", tmpDir);
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  { perror(path);
+    rmdir(tmpDir);
+    return FALSE;
+  }
+  fflush(stdout);
+  savedStdout = dup(STDOUT_FILENO);
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+  capturing = TRUE;
+  return FALSE;
+}
+
+void cacheStore(int status)
+{ long long delta[NCOUNTERS] = { 0 };
+  char path[PATH_LEN + 16], detail[PATH_LEN + 256];
+  long long size = 0, n;
+  int i;
+
+  if (! capturing) return;
+  capturing = FALSE;
+  fflush(stdout);
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+  snprintf(path, sizeof(path), "%s/stdout", tmpDir);
+  sendFile(path);
+  delta[MISSES] = 1;
+
+  if (status == 0)
+  { int ok = TRUE;
+    if ((n = fileSize(path)) > 0) size += n;
+    chmod(path, 0444); /* the stage files are linked: not to be edited */
+    for (i = 0; i < NSTAGES && ok; i++)
+    { /* the files this compilation wrote: not a stale one of a stage routed elsewhere */
+      if (!(entryStages & filesWritten() & stageFiles[i].stage)) continue;
+      snprintf(detail, sizeof(detail), "%s/%s%s", detailDir, baseName, stageFiles[i].suffix);
+      snprintf(path, sizeof(path), "%s/%s", tmpDir, stageFiles[i].suffix + 1);
+      ok = copyFile(detail, path);
+      if ((n = fileSize(path)) > 0) size += n;
+      chmod(path, 0444);
+    }
+    /* the directory of the first two digits, then the entry */
+    snprintf(path, sizeof(path), "%.*s", (int) (strrchr(entryDir, '/') - entryDir), entryDir);
+    if (ok && (mkdir(path, 0755) == 0 || errno == EEXIST) && rename(tmpDir, entryDir) == 0)
+    { delta[STORES] = 1;
+      delta[ENTRIES] = 1;
+      delta[SIZE] = size;
+    }
+  }
+  removeDir(tmpDir); /* not stored, or stored by another run first */
+  updateStats(delta, NULL);
+}
+
+void cachePrintStats(FILE * out)
+{ long long c[NCOUNTERS];
+  long long lookups;
+  if (cacheDir == NULL) return;
+  updateStats(NULL, c);
+  lookups = c[HITS] + c[MISSES];
+  fprintf(out, "cache %s: %lld hits, %lld misses this run\n", cacheDir, runHits, runMisses);
+  fprintf(out, "cache %s: %lld hits, %lld misses (%.1f%% hits), %lld entries, "
+               "%.1f of %.1f MB, %lld evictions\n",
+          cacheDir, c[HITS], c[MISSES], lookups ? 100.0 * c[HITS] / lookups : 0.0, c[ENTRIES],
+          c[SIZE] / 1048576.0, maxSize / 1048576.0, c[EVICTIONS]);
+}
@@ -0,0 +1,41 @@
+/****************************************************/
+/* File: cache.h                                    */
+/* Content-addressed cache of the compiler outputs  */
+/* (mycmcomp --cache=<dir>)                         */
+/****************************************************/
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <stdio.h>
+#include "globals.h"
+
+/* An entry is keyed by a hash of the source bytes, its name, the
+ * build ID of the compiler and the options that change the
+ * outputs. It holds the stdout of the compilation and its stage
+ * files, and lives in <dir>/<2 hex digits>/<30 hex digits>/.
+ * On a hit the stage files are hard linked into the detail path
+ * (reflinked, or copied, across file systems) and stdout is
+ * written again. The entries over the size limit are evicted
+ * least recently used first.
+ */
+
+/* uses the cache in dir, created if needed, with at most
+ * maxBytes of entries; FALSE if it cannot be used */
+int cacheOpen(const char * dir, long long maxBytes);
+
+/* looks pgm up, compiled with options into the stage files of
+ * stages in detailpath. On a hit the outputs are in place and
+ * it returns TRUE. On a miss stdout is captured from now on,
+ * until cacheStore */
+int cacheLookup(const char * pgm, const char * options, FileDestination stages,
+                const char * detailpath);
+
+/* after a miss and the compilation: writes the captured stdout,
+ * and stores it with the stage files if status is 0 */
+void cacheStore(int status);
+
+/* hits, misses, size and evictions, of this run and in total */
+void cachePrintStats(FILE * out);
+
+#endif
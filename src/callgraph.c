@@ -0,0 +1,276 @@
+/****************************************************/
+/* File: callgraph.c                                */
+/* Call graph of the C- program: leaf, recursive    */
+/* and unreachable functions                        */
+/****************************************************/
+
+#include "globals.h"
+#include "callgraph.h"
+
+#define NAMES_SIZE 211
+#define SHIFT 4
+
+static CgFunction * functions = NULL;
+static int nFunctions = 0, capFunctions = 0;
+static int finished = FALSE;
+
+/* indexes of the functions by name, chained by hash */
+typedef struct nameRec
+{ int index;
+  struct nameRec * next;
+} * NameList;
+
+static NameList names[NAMES_SIZE];
+
+static int hash(const char * key)
+{ unsigned int temp = 0;
+  int i = 0;
+  while (key[i] != '\0')
+  { temp = ((temp << SHIFT) + key[i]) % NAMES_SIZE;
+    ++i;
+  }
+  return temp;
+}
+
+static int find(const char * name)
+{ NameList l;
+  for (l = names[hash(name)]; l != NULL; l = l->next)
+    if (strcmp(functions[l->index].name, name) == 0)
+      return l->index;
+  return -1;
+}
+
+/* index of name, adding an undefined node if needed */
+static int node(const char * name)
+{ int i = find(name);
+  if (i < 0)
+  { int h = hash(name);
+    NameList l = (NameList) malloc(sizeof(*l));
+    CgFunction * f;
+    if (nFunctions == capFunctions)
+    { capFunctions = capFunctions ? 2 * capFunctions : 64;
+      functions = (CgFunction *) realloc(functions, capFunctions * sizeof(CgFunction));
+    }
+    i = nFunctions++;
+    f = &functions[i];
+    memset(f, 0, sizeof(*f));
+    f->name = (char *) malloc(strlen(name) + 1);
+    strcpy(f->name, name);
+    f->reachable = TRUE;
+    l->index = i;
+    l->next = names[h];
+    names[h] = l;
+  }
+  finished = FALSE;
+  return i;
+}
+
+void cgReset(void)
+{ int i;
+  for (i = 0; i < nFunctions; i++)
+  { free(functions[i].name);
+    free(functions[i].calls);
+  }
+  nFunctions = 0;
+  for (i = 0; i < NAMES_SIZE; i++)
+  { while (names[i] != NULL)
+    { NameList next = names[i]->next;
+      free(names[i]);
+      names[i] = next;
+    }
+  }
+  finished = FALSE;
+}
+
+void cgAddFunction(const char * name, int lineno)
+{ int i = node(name); /* may move the array */
+  CgFunction * f = &functions[i];
+  if (f->defined) return;
+  f->defined = TRUE;
+  f->builtin = (lineno == 0);
+  f->lineno = lineno;
+}
+
+void cgAddCall(const char * caller, const char * callee, int lineno)
+{ int from, to, i;
+  CgFunction * f;
+  if (caller == NULL || caller[0] == '\0') return;
+  from = node(caller);
+  to = node(callee);
+  f = &functions[from];
+  for (i = 0; i < f->nCalls; i++)
+    if (f->calls[i].callee == to)
+    { f->calls[i].count++;
+      return;
+    }
+  if (f->nCalls == f->capCalls)
+  { f->capCalls = f->capCalls ? 2 * f->capCalls : 4;
+    f->calls = (CgCall *) realloc(f->calls, f->capCalls * sizeof(CgCall));
+  }
+  f->calls[f->nCalls].callee = to;
+  f->calls[f->nCalls].lineno = lineno;
+  f->calls[f->nCalls].count = 1;
+  f->nCalls++;
+}
+
+/* Tarjan's strongly connected components, with an explicit
+ * stack so long chains of calls do not recurse */
+static void tagRecursive(void)
+{ int * index = (int *) malloc(nFunctions * sizeof(int));
+  int * low = (int *) malloc(nFunctions * sizeof(int));
+  int * onStack = (int *) calloc(nFunctions, sizeof(int));
+  int * stack = (int *) malloc(nFunctions * sizeof(int));
+  int * callStack = (int *) malloc(nFunctions * sizeof(int));
+  int * nextCall = (int *) malloc(nFunctions * sizeof(int));
+  int counter = 0, sp = 0, root, i;
+
+  for (i = 0; i < nFunctions; i++) index[i] = -1;
+  for (root = 0; root < nFunctions; root++)
+  { int depth = 0;
+    if (index[root] >= 0) continue;
+    callStack[0] = root;
+    nextCall[0] = 0;
+    index[root] = low[root] = counter++;
+    stack[sp++] = root;
+    onStack[root] = TRUE;
+    while (depth >= 0)
+    { int v = callStack[depth];
+      CgFunction * f = &functions[v];
+      if (nextCall[depth] < f->nCalls)
+      { int w = f->calls[nextCall[depth]++].callee;
+        if (w == v) f->recursive = TRUE;
+        if (index[w] < 0)
+        { index[w] = low[w] = counter++;
+          stack[sp++] = w;
+          onStack[w] = TRUE;
+          callStack[++depth] = w;
+          nextCall[depth] = 0;
+        }
+        else if (onStack[w] && index[w] < low[v])
+          low[v] = index[w];
+      }
+      else
+      { if (low[v] == index[v])
+        { /* v is the root of a component: pop it */
+          int first = sp;
+          do first--; while (stack[first] != v);
+          for (i = first; i < sp; i++)
+          { onStack[stack[i]] = FALSE;
+            if (sp - first > 1) functions[stack[i]].recursive = TRUE;
+          }
+          sp = first;
+        }
+        if (--depth >= 0)
+        { int u = callStack[depth];
+          if (low[v] < low[u]) low[u] = low[v];
+        }
+      }
+    }
+  }
+  free(index); free(low); free(onStack);
+  free(stack); free(callStack); free(nextCall);
+}
+
+static void tagReachable(void)
+{ int root = find("main");
+  int * work, n = 0, i;
+  /* without main everything is kept */
+  if (root < 0 || !functions[root].defined) return;
+  for (i = 0; i < nFunctions; i++)
+    functions[i].reachable = FALSE;
+  work = (int *) malloc(nFunctions * sizeof(int));
+  functions[root].reachable = TRUE;
+  work[n++] = root;
+  while (n > 0)
+  { CgFunction * f = &functions[work[--n]];
+    for (i = 0; i < f->nCalls; i++)
+    { CgFunction * g = &functions[f->calls[i].callee];
+      if (!g->reachable)
+      { g->reachable = TRUE;
+        work[n++] = f->calls[i].callee;
+      }
+    }
+  }
+  free(work);
+}
+
+void cgFinish(void)
+{ int i, j;
+  for (i = 0; i < nFunctions; i++)
+  { CgFunction * f = &functions[i];
+    f->recursive = FALSE;
+    f->reachable = TRUE;
+    f->leaf = TRUE;
+    for (j = 0; j < f->nCalls; j++)
+      if (!functions[f->calls[j].callee].builtin)
+        f->leaf = FALSE;
+  }
+  tagRecursive();
+  tagReachable();
+  finished = TRUE;
+}
+
+CgFunction * cgFunction(int i)
+{ return (i >= 0 && i < nFunctions) ? &functions[i] : NULL;
+}
+
+int cgCount(void)
+{ return nFunctions;
+}
+
+CgFunction * cgLookup(const char * name)
+{ int i = find(name);
+  return (i >= 0) ? &functions[i] : NULL;
+}
+
+int cgIsReachable(const char * name)
+{ CgFunction * f;
+  if (!finished) return TRUE;
+  f = cgLookup(name);
+  return f == NULL || f->reachable;
+}
+
+void cgPrintDot(FILE * out)
+{ int i, j;
+  fprintf(out,"digraph callgraph {\n");
+  for (i = 0; i < nFunctions; i++)
+  { CgFunction * f = &functions[i];
+    fprintf(out,"  \"%s\" [label=\"%s%s%s%s\"%s%s%s];\n", f->name, f->name,
+            f->leaf && !f->builtin ? "\\nleaf" : "",
+            f->recursive ? "\\nrecursive" : "",
+            f->reachable ? "" : "\\nunreachable",
+            f->builtin ? ", shape=box" : "",
+            f->recursive ? ", color=red" : "",
+            f->reachable ? "" : ", style=dashed");
+  }
+  for (i = 0; i < nFunctions; i++)
+  { CgFunction * f = &functions[i];
+    for (j = 0; j < f->nCalls; j++)
+    { fprintf(out,"  \"%s\" -> \"%s\"", f->name, functions[f->calls[j].callee].name);
+      if (f->calls[j].count > 1)
+        fprintf(out," [label=\"%d\"]", f->calls[j].count);
+      fprintf(out,";\n");
+    }
+  }
+  fprintf(out,"}\n");
+}
+
+void cgPrintJson(FILE * out)
+{ int i, j;
+  fprintf(out,"{\"functions\": [");
+  for (i = 0; i < nFunctions; i++)
+  { CgFunction * f = &functions[i];
+    fprintf(out,"%s\n  {\"name\": \"%s\", \"line\": %d, \"defined\": %s, \"builtin\": %s, "
+                "\"leaf\": %s, \"recursive\": %s, \"reachable\": %s, \"calls\": [",
+            i ? "," : "", f->name, f->lineno,
+            f->defined ? "true" : "false", f->builtin ? "true" : "false",
+            f->leaf ? "true" : "false", f->recursive ? "true" : "false",
+            f->reachable ? "true" : "false");
+    for (j = 0; j < f->nCalls; j++)
+      fprintf(out,"%s{\"callee\": \"%s\", \"line\": %d, \"count\": %d}",
+              j ? ", " : "", functions[f->calls[j].callee].name,
+              f->calls[j].lineno, f->calls[j].count);
+    fprintf(out,"]}");
+  }
+  fprintf(out,"\n]}\n");
+}
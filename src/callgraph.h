@@ -0,0 +1,58 @@
+/****************************************************/
+/* File: callgraph.h                                */
+/* Call graph of the C- program, built during       */
+/* semantic analysis                                */
+/****************************************************/
+
+#ifndef _CALLGRAPH_H_
+#define _CALLGRAPH_H_
+
+#include <stdio.h>
+
+typedef struct cgCall
+{ int callee;    /* index of the called function */
+  int lineno;    /* line of the first call */
+  int count;     /* calls from the same caller */
+} CgCall;
+
+typedef struct cgFunction
+{ char * name;
+  int lineno;    /* line of the first definition, 0 for built-ins */
+  int defined;   /* defined in the program or built-in */
+  int builtin;
+  CgCall * calls;
+  int nCalls, capCalls;
+  /* tags, valid after cgFinish */
+  int leaf;      /* calls no function of the program */
+  int recursive; /* takes part in a cycle of calls */
+  int reachable; /* called, directly or not, from main */
+} CgFunction;
+
+/* clears the graph */
+void cgReset(void);
+
+/* a function definition; lineno 0 marks a built-in */
+void cgAddFunction(const char * name, int lineno);
+
+/* a call of callee inside the body of caller */
+void cgAddCall(const char * caller, const char * callee, int lineno);
+
+/* computes the leaf, recursive and reachable tags */
+void cgFinish(void);
+
+/* functions in order of first appearance; NULL if out of range */
+CgFunction * cgFunction(int i);
+int cgCount(void);
+
+/* NULL if name was never defined nor called */
+CgFunction * cgLookup(const char * name);
+
+/* false only for functions known to be unreachable from main:
+ * code generation skips them */
+int cgIsReachable(const char * name);
+
+/* prints the graph in Graphviz DOT or JSON */
+void cgPrintDot(FILE * out);
+void cgPrintJson(FILE * out);
+
+#endif
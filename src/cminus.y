@@ -11,11 +11,13 @@
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "diag.h"
 
 #define YYSTYPE TreeNode *
 static char * savedName; /* for use in assignments */
 static int savedLineNo;  /* ditto */
 static TreeNode * savedTree; /* stores syntax tree for later return */
+static int lastScopeId = -1; /* id of the last scope pushed */
 static int yylex(void);
 int yyerror(char *);
 
@@ -71,7 +73,11 @@ var_declaracao      : tipo_especificador ID SEMI {
 tipo_especificador  : INT { $$ = newTypeNode(Int); }
                     | VOID { $$ = newTypeNode(Void); }
                     ;
-fun_declaracao      : tipo_especificador ID { savedLineNo = lineno; } LPAREN params RPAREN composto_decl {
+fun_declaracao      : tipo_especificador ID {
+                      savedLineNo = lineno;
+                      /* params and body live in the function scope */
+                      currentScope = insertScope(currentScope, copyString(peekId()), lastScopeId++);
+                    } LPAREN params RPAREN composto_decl {
                       $$ = $1;
                       $$->child[0] = newIdNode(Function);
                       $$->child[0]->attr.name = copyString(popId());
@@ -80,6 +86,7 @@ fun_declaracao      : tipo_especificador ID { savedLineNo = lineno; } LPAREN par
                       $$->child[0]->child[0] = $5;
                       $$->child[0]->child[1] = $7;
                       $$->child[0]->scopeNode = scopeTree; /* all functions are global */
+                      currentScope = currentScope->parent;
                     }
                     ;
 params              : param_lista { $$ = $1; }
@@ -115,16 +122,20 @@ param               : tipo_especificador ID {
                       $$->child[0]->scopeNode = currentScope;
                     }
                     ;
-composto_decl       : LCURBR local_declaracoes statement_lista RCURBR {
-                      YYSTYPE t = $2;
+composto_decl       : LCURBR {
+                      /* each block opens a scope nested in the current one */
+                      currentScope = insertScope(currentScope, currentScope->scope->name, lastScopeId++);
+                    } local_declaracoes statement_lista RCURBR {
+                      YYSTYPE t = $3;
                       if (t != NULL) {
                         while (t->sibling != NULL) {
                           t = t->sibling;
                         }
-                        t->sibling = $3;
-                        $$ = $2;
+                        t->sibling = $4;
+                        $$ = $3;
                       }
-                      else $$ = $3;
+                      else $$ = $4;
+                      currentScope = currentScope->parent;
                     }
                     ;
 local_declaracoes   : local_declaracoes var_declaracao {
@@ -325,9 +336,7 @@ arg_lista           : arg_lista COL expressao {
 %%
 
 int yyerror(char * message)
-{ pce("Syntax error at line %d: %s\n",lineno,message);
-  pce("Current token: ");
-  printToken(yychar,tokenString);
+{ diagSyntax(lineno,message,yychar,tokenString);
   Error = TRUE;
   return 0;
 }
@@ -339,7 +348,11 @@ static int yylex(void)
 { return getToken(); }
 
 TreeNode * parse(void)
-{ yyparse();
+{ scopeTree = newRootScopeNode();
+  currentScope = scopeTree;
+  lastScopeId = -1;
+  savedTree = NULL;
+  yyparse();
   return savedTree;
 }
 
@@ -0,0 +1,428 @@
+/****************************************************/
+/* File: cst.c                                      */
+/* Tabela de símbolos concorrente (shards com lock  */
+/* na inserção e buscas sem lock)                   */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "cst.h"
+#include "symtab.h" /* printSymHeader, printSymRow */
+
+#define DEFAULT_SHARDS 64
+#define TABLE_SIZE 4096    /* buckets no total, divididos entre os shards */
+#define CACHE_LINE 64
+
+typedef unsigned long long OrderKey;
+
+/* Cada linha guarda a chave da inserção que a registrou, para
+   que cst_merge as ponha na ordem da execução serial */
+typedef struct CstLineRec
+{
+    int lineno;
+    OrderKey key;
+    struct CstLineRec *next;
+} *CstLine;
+
+/* Um símbolo. Tudo menos 'lines' e 'order' é imutável depois de
+   publicado na cadeia, por isso as buscas não travam */
+typedef struct CstSymRec
+{
+    char *name;
+    char *scope;
+    char *idType;
+    char *dataType;
+    CstLine lines;        /* protegida pelo lock do shard */
+    OrderKey key;         /* chave da inserção que o criou */
+    int order;            /* posição global, após cst_merge */
+    struct CstSymRec *next;
+} *CstSym;
+
+/* Shards ocupam linhas de cache distintas */
+typedef struct
+{
+    pthread_mutex_t lock;
+    CstSym *buckets;
+} __attribute__((aligned(CACHE_LINE))) Shard;
+
+/* Símbolos criados por uma thread, em ordem */
+typedef struct CstLogRec
+{
+    CstSym *syms;
+    int n, cap;
+    struct CstLogRec *next;
+} *CstLog;
+
+static Shard *shards = NULL;
+static int nShards = 0;
+static int shardSize = 0;   /* buckets por shard */
+
+/* logs de todas as threads, na ordem de registro */
+static CstLog logs = NULL;
+static pthread_mutex_t logsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* incrementado a cada cst_init: invalida os logs das threads */
+static int generation = 0;
+
+static __thread CstLog threadLog = NULL;
+static __thread int threadGeneration = -1;
+static __thread unsigned int threadUnit = 0;
+static __thread unsigned int threadSeq = 0;
+
+/* ordem global, montada por cst_merge */
+static CstSym *merged = NULL;
+static int mergedCount = 0;
+
+/*---------------------------------------------*/
+/* Hash FNV-1a: os bits baixos escolhem o      */
+/* shard e os altos o bucket dentro dele       */
+/*---------------------------------------------*/
+static unsigned int hash(const char *key)
+{
+    unsigned int h = 2166136261u;
+    for (; *key != '\0'; key++)
+        h = (h ^ (unsigned char)*key) * 16777619u;
+    return h;
+}
+
+static char *dupString(const char *s)
+{
+    char *t;
+    if (s == NULL) return NULL;
+    t = (char *)malloc(strlen(s) + 1);
+    strcpy(t, s);
+    return t;
+}
+
+static CstSym *bucketOf(const char *name)
+{
+    unsigned int h = hash(name);
+    Shard *s = &shards[h & (nShards - 1)];
+    return &s->buckets[(h >> 8) % shardSize];
+}
+
+static Shard *shardOf(const char *name)
+{
+    return &shards[hash(name) & (nShards - 1)];
+}
+
+/*---------------------------------------------*/
+/* Percorre a cadeia sem lock: os nós só são   */
+/* publicados (release) depois de prontos      */
+/*---------------------------------------------*/
+static CstSym findIn(CstSym *bucket, const char *name, const char *scope)
+{
+    CstSym p = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+    while (p != NULL && (strcmp(p->name, name) != 0 || strcmp(p->scope, scope) != 0))
+        p = p->next;
+    return p;
+}
+
+static CstSym findWithGlobal(const char *name, const char *scope)
+{
+    CstSym *bucket = bucketOf(name);
+    CstSym p = findIn(bucket, name, scope);
+    if (p == NULL && scope[0] != '\0')
+        p = findIn(bucket, name, "");
+    return p;
+}
+
+static OrderKey nextKey(void)
+{
+    return ((OrderKey)threadUnit << 32) | threadSeq++;
+}
+
+/*---------------------------------------------*/
+/* Log da thread, registrado na primeira       */
+/* inserção depois de cada cst_init            */
+/*---------------------------------------------*/
+static CstLog myLog(void)
+{
+    if (threadGeneration != generation)
+    {
+        CstLog log = (CstLog)calloc(1, sizeof(*log));
+        pthread_mutex_lock(&logsLock);
+        /* no fim da lista, para manter a ordem de registro */
+        CstLog *link = &logs;
+        while (*link != NULL)
+            link = &(*link)->next;
+        *link = log;
+        pthread_mutex_unlock(&logsLock);
+        threadLog = log;
+        threadGeneration = generation;
+    }
+    return threadLog;
+}
+
+static void logSymbol(CstSym sym)
+{
+    CstLog log = myLog();
+    if (log->n == log->cap)
+    {
+        log->cap = log->cap ? 2 * log->cap : 256;
+        log->syms = (CstSym *)realloc(log->syms, log->cap * sizeof(CstSym));
+    }
+    log->syms[log->n++] = sym;
+}
+
+static CstLine newLine(int lineno, OrderKey key)
+{
+    CstLine l = (CstLine)malloc(sizeof(*l));
+    l->lineno = lineno;
+    l->key    = key;
+    l->next   = NULL;
+    return l;
+}
+
+/*---------------------------------------------*/
+/* Inicialização e liberação                   */
+/*---------------------------------------------*/
+void cst_free(void)
+{
+    for (int s = 0; s < nShards; s++)
+    {
+        for (int b = 0; b < shardSize; b++)
+        {
+            CstSym p = shards[s].buckets[b];
+            while (p != NULL)
+            {
+                CstSym next = p->next;
+                while (p->lines != NULL)
+                {
+                    CstLine l = p->lines->next;
+                    free(p->lines);
+                    p->lines = l;
+                }
+                free(p->name);
+                free(p->scope);
+                free(p->idType);
+                free(p->dataType);
+                free(p);
+                p = next;
+            }
+        }
+        free(shards[s].buckets);
+        pthread_mutex_destroy(&shards[s].lock);
+    }
+    free(shards);
+    shards = NULL;
+    nShards = 0;
+
+    while (logs != NULL)
+    {
+        CstLog next = logs->next;
+        free(logs->syms);
+        free(logs);
+        logs = next;
+    }
+    generation++;
+
+    free(merged);
+    merged = NULL;
+    mergedCount = 0;
+}
+
+void cst_init(int n)
+{
+    int count = 1;
+
+    cst_free();
+    if (n <= 0) n = DEFAULT_SHARDS;
+    while (count < n)
+        count *= 2;
+
+    if (posix_memalign((void **)&shards, CACHE_LINE, count * sizeof(Shard)) != 0)
+    {
+        fprintf(stderr, "out of memory allocating symbol table shards\n");
+        abort();
+    }
+    memset(shards, 0, count * sizeof(Shard));
+    shardSize = (count < TABLE_SIZE) ? TABLE_SIZE / count : 1;
+    for (int s = 0; s < count; s++)
+    {
+        pthread_mutex_init(&shards[s].lock, NULL);
+        shards[s].buckets = (CstSym *)calloc(shardSize, sizeof(CstSym));
+    }
+    nShards = count;
+}
+
+void cst_setUnit(int unit)
+{
+    threadUnit = (unsigned int)unit;
+    threadSeq = 0;
+}
+
+/*-------------------------------------------------------*/
+/* cst_insert: como st_insert. A redeclaração é vista    */
+/* sem lock; criar um símbolo ou registrar uma linha     */
+/* trava o shard do nome                                 */
+/*-------------------------------------------------------*/
+int cst_insert(const char *name, int lineno,
+               const char *scope,
+               const char *idType,
+               const char *dataType)
+{
+    CstSym *bucket = bucketOf(name);
+    Shard *shard = shardOf(name);
+    OrderKey key = nextKey();
+    CstSym p;
+
+    if (idType != NULL && findIn(bucket, name, scope) != NULL)
+        return 1;
+
+    pthread_mutex_lock(&shard->lock);
+    p = findIn(bucket, name, scope);
+    if (p == NULL)
+    {
+        p = (CstSym)malloc(sizeof(*p));
+        p->name     = dupString(name);
+        p->scope    = dupString(scope);
+        p->idType   = dupString(idType);
+        p->dataType = dupString(dataType);
+        p->lines    = (lineno != 0) ? newLine(lineno, key) : NULL;
+        p->key      = key;
+        p->order    = -1;
+        p->next     = *bucket;
+        __atomic_store_n(bucket, p, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&shard->lock);
+
+        logSymbol(p);
+        return 0;
+    }
+    if (idType != NULL)
+    {
+        pthread_mutex_unlock(&shard->lock);
+        return 1;
+    }
+    if (lineno != 0)
+    {
+        CstLine *link = &p->lines;
+        while (*link != NULL && (*link)->lineno != lineno)
+            link = &(*link)->next;
+        if (*link == NULL)
+            *link = newLine(lineno, key);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return 0;
+}
+
+/*------------------------------------------------------------*/
+/* Buscas (sem lock)                                          */
+/*------------------------------------------------------------*/
+int cst_lookup(const char *name, const char *scope)
+{
+    return findWithGlobal(name, scope) != NULL;
+}
+
+int cst_lookup_local(const char *name, const char *scope)
+{
+    return findIn(bucketOf(name), name, scope) != NULL;
+}
+
+const char *cst_symbolType(const char *name, const char *scope)
+{
+    CstSym p = findWithGlobal(name, scope);
+    return (p != NULL) ? p->idType : NULL;
+}
+
+const char *cst_dataType(const char *name, const char *scope)
+{
+    CstSym p = findWithGlobal(name, scope);
+    return (p != NULL) ? p->dataType : NULL;
+}
+
+/*------------------------------------------------------------*/
+/* cst_merge: ordena os símbolos de todos os logs pela chave  */
+/* e as linhas de cada símbolo também                         */
+/*------------------------------------------------------------*/
+static int compareSyms(const void *a, const void *b)
+{
+    OrderKey ka = (*(const CstSym *)a)->key;
+    OrderKey kb = (*(const CstSym *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+static void sortLines(CstSym p)
+{
+    /* inserção: as listas são curtas e quase sempre já ordenadas */
+    CstLine sorted = NULL;
+    while (p->lines != NULL)
+    {
+        CstLine l = p->lines;
+        CstLine *link = &sorted;
+        p->lines = l->next;
+        while (*link != NULL && (*link)->key <= l->key)
+            link = &(*link)->next;
+        l->next = *link;
+        *link = l;
+    }
+    p->lines = sorted;
+}
+
+int cst_merge(void)
+{
+    int n = 0, i = 0;
+
+    for (CstLog log = logs; log != NULL; log = log->next)
+        n += log->n;
+    merged = (CstSym *)realloc(merged, (n > 0 ? n : 1) * sizeof(CstSym));
+    for (CstLog log = logs; log != NULL; log = log->next)
+    {
+        memcpy(merged + i, log->syms, log->n * sizeof(CstSym));
+        i += log->n;
+    }
+
+    /* logs de uma thread já vêm em ordem; a estabilidade entre
+       threads com chaves iguais (mesma unidade) não é garantida */
+    qsort(merged, n, sizeof(CstSym), compareSyms);
+    for (i = 0; i < n; i++)
+    {
+        merged[i]->order = i;
+        sortLines(merged[i]);
+    }
+    mergedCount = n;
+    return n;
+}
+
+int cst_order(const char *name, const char *scope)
+{
+    CstSym p = findIn(bucketOf(name), name, scope);
+    return (p != NULL) ? p->order : -1;
+}
+
+int cst_count(void)
+{
+    return mergedCount;
+}
+
+/*------------------------------------------------------------*/
+/* cst_print: imprime com printSymHeader/printSymRow, no      */
+/* mesmo formato de printSymTab                               */
+/*------------------------------------------------------------*/
+void cst_print(void)
+{
+    static int *lines = NULL;
+    static int capLines = 0;
+
+    printSymHeader();
+    for (int i = 0; i < mergedCount; i++)
+    {
+        CstSym p = merged[i];
+        int n = 0;
+
+        for (CstLine l = p->lines; l != NULL; l = l->next)
+        {
+            if (n == capLines)
+            {
+                capLines = capLines ? 2 * capLines : 64;
+                lines = (int *)realloc(lines, capLines * sizeof(int));
+            }
+            lines[n++] = l->lineno;
+        }
+        printSymRow(p->name, p->scope, p->idType ? p->idType : "",
+                    p->dataType ? p->dataType : "", lines, n);
+    }
+}
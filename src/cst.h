@@ -0,0 +1,66 @@
+/****************************************************/
+/* File: cst.h                                      */
+/* Tabela de símbolos concorrente: a mesma interface*/
+/* de symtab.h, segura para várias threads          */
+/****************************************************/
+#ifndef _CST_H_
+#define _CST_H_
+
+/*
+  A tabela é dividida em shards pelo hash do nome. Buscas não
+  travam nada; inserções travam só o shard do nome.
+
+  A ordem de inserção (usada por cst_order e cst_print) é a das
+  chaves (unidade, sequência): cada thread declara em que unidade
+  está com cst_setUnit e as inserções dela são numeradas em
+  sequência dentro da unidade. Cada thread guarda as suas num log
+  próprio; cst_merge junta os logs e fixa a ordem global, que
+  independe do escalonamento das threads desde que cada (name,
+  scope) seja declarado por uma única unidade.
+
+  A tabela é independente: analyze.c (inclusive com --jobs=N)
+  continua usando symtab.c, e só bench/cst_bench a exercita.
+*/
+
+/* Inicializa (ou reinicia) a tabela com 'shards' shards,
+   arredondado para potência de 2; 0 => padrão */
+void cst_init(int shards);
+
+/* Libera todos os símbolos */
+void cst_free(void);
+
+/* Unidade das próximas inserções da thread (ex: índice da
+   declaração de topo); recomeça a sequência */
+void cst_setUnit(int unit);
+
+/* Como st_insert: declaração se idType != NULL (1 se já existe
+   no escopo), senão registra uma linha de uso */
+int cst_insert(const char *name, int lineno,
+               const char *scope,
+               const char *idType,
+               const char *dataType);
+
+/* Como st_lookup e st_lookup_local */
+int cst_lookup(const char *name, const char *scope);
+int cst_lookup_local(const char *name, const char *scope);
+
+/* Como st_symbolType e st_dataType */
+const char *cst_symbolType(const char *name, const char *scope);
+const char *cst_dataType(const char *name, const char *scope);
+
+/* Junta os logs das threads na ordem global e ordena as linhas
+   de cada símbolo. Chamar sem inserções em andamento.
+   Retorna o número de símbolos */
+int cst_merge(void);
+
+/* Posição de (name, scope) exato na ordem global (válida após
+   cst_merge), ou -1 */
+int cst_order(const char *name, const char *scope);
+
+/* Número de símbolos na ordem global (após cst_merge) */
+int cst_count(void);
+
+/* Imprime a tabela como printSymTab (após cst_merge) */
+void cst_print(void);
+
+#endif
@@ -0,0 +1,196 @@
+/****************************************************/
+/* File: diag.c                                     */
+/* Buffered diagnostics for the C- compiler         */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "util.h"
+#include "diag.h"
+
+typedef struct
+{ DiagSeverity severity;
+  int lineno;
+  DiagCode code;
+  char * arg;
+  TokenType token;   /* DIAG_SYNTAX: current token */
+  char * lexeme;
+  int seq;           /* order of report, breaks ties */
+} Diagnostic;
+
+static const struct
+{ const char * name;    /* code in the JSON output */
+  const char * format;  /* message, with the argument as %s */
+} codes[DIAG_NCODES] =
+{ { "bad-token",            "invalid token %s" },
+  { "syntax",               "%s" },
+  { "undeclared",           "'%s' was not declared in this scope" },
+  { "void-variable",        "variable declared void" },
+  { "redeclared-function",  "'%s' was already declared as a function" },
+  { "redeclared-variable",  "'%s' was already declared as a variable" },
+  { "void-use",             "invalid use of void expression" },
+  { "no-main",              "undefined reference to 'main'" }
+};
+
+static Diagnostic * batch = NULL;
+static int nBatch = 0, capBatch = 0, nextSeq = 0;
+
+static int errorCount = 0;
+static int maxErrors = 0;
+static int limitReached = FALSE;
+static int limitAnnounced = FALSE;
+static DiagFormat format = DIAG_TEXT;
+
+static char * dup(const char * s)
+{ return s == NULL ? NULL : copyString((char *) s);
+}
+
+static Diagnostic * add(DiagSeverity severity, int lineno, DiagCode code, const char * arg)
+{ Diagnostic * d;
+  if (severity == DIAG_ERROR)
+  { errorCount++;
+    if (maxErrors > 0 && errorCount > maxErrors)
+    { limitReached = TRUE;
+      return NULL;
+    }
+  }
+  if (nBatch == capBatch)
+  { capBatch = capBatch ? 2 * capBatch : 64;
+    batch = (Diagnostic *) realloc(batch, capBatch * sizeof(Diagnostic));
+  }
+  d = &batch[nBatch++];
+  d->severity = severity;
+  d->lineno = lineno;
+  d->code = code;
+  d->arg = dup(arg);
+  d->token = 0;
+  d->lexeme = NULL;
+  d->seq = nextSeq++;
+  return d;
+}
+
+void diagReport(DiagSeverity severity, int lineno, DiagCode code, const char * arg)
+{ add(severity, lineno, code, arg);
+}
+
+void diagSyntax(int lineno, const char * message, TokenType token, const char * lexeme)
+{ Diagnostic * d = add(DIAG_ERROR, lineno, DIAG_SYNTAX, message);
+  if (d != NULL)
+  { d->token = token;
+    d->lexeme = dup(lexeme);
+  }
+}
+
+static int compareDiags(const void * a, const void * b)
+{ const Diagnostic * x = (const Diagnostic *) a;
+  const Diagnostic * y = (const Diagnostic *) b;
+  int lx = x->lineno > 0 ? x->lineno : INT_MAX;
+  int ly = y->lineno > 0 ? y->lineno : INT_MAX;
+  if (lx != ly) return lx < ly ? -1 : 1;
+  return x->seq - y->seq;
+}
+
+static void emitText(Diagnostic * d)
+{ const char * kind = d->severity == DIAG_ERROR ? "error" : "warning";
+  switch (d->code)
+  { case DIAG_BAD_TOKEN:
+      /* the token listing already shows it in place */
+      if (TRACE_ON(TraceScan)) pf(ER_, "ERROR: %s\n", d->arg);
+      else pce("ERROR: %s\n", d->arg);
+      break;
+    case DIAG_SYNTAX:
+      pce("Syntax %s at line %d: %s\n", kind, d->lineno, d->arg);
+      pce("Current token: ");
+      if (d->token == ERROR) pce("ERROR: %s\n", d->lexeme);
+      else printToken(d->token, d->lexeme);
+      break;
+    default:
+      if (d->lineno > 0) pce("Semantic %s at line %d: ", kind, d->lineno);
+      else pce("Semantic %s: ", kind);
+      pce(codes[d->code].format, d->arg);
+      pce("\n");
+      break;
+  }
+}
+
+/* writes s as a JSON string: bytes outside printable ASCII
+ * are escaped, so a bad character in the source stays valid */
+static void jsonString(char * out, size_t size, const char * s)
+{ size_t n = 0;
+  out[n++] = '"';
+  for (; s != NULL && *s != '\0' && n + 8 < size; s++)
+  { unsigned char c = (unsigned char) *s;
+    if (c == '"' || c == '\\')
+    { out[n++] = '\\';
+      out[n++] = c;
+    }
+    else if (c < 0x20 || c >= 0x7f)
+      n += snprintf(out + n, size - n, "\\u%04x", c);
+    else out[n++] = c;
+  }
+  out[n++] = '"';
+  out[n] = '\0';
+}
+
+static void emitJson(Diagnostic * d)
+{ char message[512], quoted[1100], lexeme[300];
+  snprintf(message, sizeof(message), codes[d->code].format, d->arg ? d->arg : "");
+  jsonString(quoted, sizeof(quoted), message);
+  pce("{\"severity\": \"%s\", \"line\": ", d->severity == DIAG_ERROR ? "error" : "warning");
+  if (d->lineno > 0) pce("%d", d->lineno);
+  else pce("null");
+  pce(", \"code\": \"%s\", \"message\": %s", codes[d->code].name, quoted);
+  if (d->code == DIAG_SYNTAX)
+  { jsonString(lexeme, sizeof(lexeme), d->lexeme);
+    pce(", \"token\": %s", lexeme);
+  }
+  pce("}\n");
+}
+
+int diagFlush(void)
+{ int i, n = nBatch;
+  if (nBatch > 1) qsort(batch, nBatch, sizeof(Diagnostic), compareDiags);
+  for (i = 0; i < nBatch; i++)
+  { if (format == DIAG_JSON) emitJson(&batch[i]);
+    else emitText(&batch[i]);
+    free(batch[i].arg);
+    free(batch[i].lexeme);
+  }
+  nBatch = 0;
+  if (limitReached && !limitAnnounced)
+  { if (format == DIAG_JSON)
+      pce("{\"severity\": \"fatal\", \"line\": null, \"code\": \"max-errors\", "
+          "\"message\": \"too many errors (%d), stopping\"}\n", maxErrors);
+    else
+      pce("too many errors (--max-errors=%d), stopping\n", maxErrors);
+    limitAnnounced = TRUE;
+  }
+  return n;
+}
+
+int diagErrorCount(void)
+{ return errorCount;
+}
+
+void diagSetMaxErrors(int n)
+{ maxErrors = n;
+}
+
+int diagLimitReached(void)
+{ return limitReached;
+}
+
+void diagSetFormat(DiagFormat f)
+{ format = f;
+}
+
+void diagReset(void)
+{ int i;
+  for (i = 0; i < nBatch; i++)
+  { free(batch[i].arg);
+    free(batch[i].lexeme);
+  }
+  nBatch = nextSeq = 0;
+  errorCount = 0;
+  limitReached = limitAnnounced = FALSE;
+}
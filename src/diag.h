@@ -0,0 +1,58 @@
+/****************************************************/
+/* File: diag.h                                     */
+/* Buffered diagnostics for the C- compiler         */
+/****************************************************/
+
+#ifndef _DIAG_H_
+#define _DIAG_H_
+
+#include "globals.h"
+
+typedef enum { DIAG_ERROR, DIAG_WARNING } DiagSeverity;
+
+/* one code per message; the arguments are strings */
+typedef enum
+{ DIAG_BAD_TOKEN,        /* lexeme */
+  DIAG_SYNTAX,           /* parser message; see diagSyntax */
+  DIAG_UNDECLARED,       /* name */
+  DIAG_VOID_VARIABLE,    /* name */
+  DIAG_REDECL_FUNCTION,  /* name */
+  DIAG_REDECL_VARIABLE,  /* name */
+  DIAG_VOID_USE,         /* name of the void function */
+  DIAG_NO_MAIN,
+  DIAG_NCODES
+} DiagCode;
+
+typedef enum { DIAG_TEXT, DIAG_JSON } DiagFormat;
+
+/* Diagnostics are stored as records and only formatted by
+ * diagFlush, which each phase calls at its end: the batch is
+ * emitted sorted by line (records without a line go last, ties
+ * keep the order of report) in the current stage file, the
+ * error file and stdout.
+ */
+
+/* records a diagnostic; lineno 0 means no line */
+void diagReport(DiagSeverity severity, int lineno, DiagCode code, const char * arg);
+
+/* records a syntax error at token (with its lexeme) */
+void diagSyntax(int lineno, const char * message, TokenType token, const char * lexeme);
+
+/* emits and clears the pending batch; returns how many were emitted */
+int diagFlush(void);
+
+/* errors reported so far, including the ones dropped by the limit */
+int diagErrorCount(void);
+
+/* after n errors (0 = no limit) further reports are dropped and
+ * diagLimitReached tells the pipeline to stop after the phase */
+void diagSetMaxErrors(int n);
+int diagLimitReached(void);
+
+void diagSetFormat(DiagFormat format);
+
+/* drops the pending records and the error count of the last
+ * source file (the limit and the format are kept) */
+void diagReset(void);
+
+#endif
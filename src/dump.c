@@ -0,0 +1,428 @@
+/****************************************************/
+/* File: dump.c                                     */
+/* Binary dump of the stage listings                */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "dump.h"
+
+/* File layout: the magic, the name of the source, then records.
+ * A record is a byte with its type and stage (see RECORD) and
+ * its fields. Numbers are unsigned LEB128 varints, signed ones
+ * zigzag encoded; line numbers are stored as the difference to
+ * the last one. Names and lines of source are interned: a
+ * varint 0 is followed by a new string (length and bytes), k
+ * refers to the k-th string seen. Text is never interned.
+ */
+#define DUMP_MAGIC "CMB1"
+
+typedef enum
+{ REC_END,
+  REC_TEXT,      /* text */
+  REC_ECHO,      /* lineno, line */
+  REC_TOKEN,     /* lineno, token, lexeme */
+  REC_TREE,      /* nodes, see writeNode */
+  REC_SYMHEAD,
+  REC_SYMBOL     /* name, scope, idType, dataType, n, lines */
+} RecordType;
+
+/* record type in the low bits, stage index (log2 of its
+ * FileDestination bit) in the high ones */
+#define RECORD(type, stage) ((type) | (stage) << 3)
+#define RECORD_TYPE(b)      ((b) & 7)
+#define RECORD_STAGE(b)     ((FileDestination) (1 << ((b) >> 3)))
+
+/* a tree node in one byte: children present, sibling present,
+ * node kind and kind */
+#define NODE_CHILD(i)  (1 << (i))
+#define NODE_SIBLING   (1 << MAXCHILDREN)
+#define NODE_BYTE(flags, nodekind, kind) ((flags) | (nodekind) << 4 | (kind) << 6)
+#define NODE_FLAGS(b)    ((b) & 0xf)
+#define NODE_NODEKIND(b) (((b) >> 4) & 3)
+#define NODE_KIND(b)     (((b) >> 6) & 3)
+
+#define DUMP_BUFFER_SIZE (64 * 1024)
+
+static FILE * out = NULL;
+static int lastLine = 0;
+
+/* interned strings of the writer, open addressing */
+static char ** interned = NULL;
+static int * internedId = NULL;
+static int capInterned = 0, nInterned = 0;
+
+static void putVarint(unsigned long v)
+{ while (v >= 0x80)
+  { putc((int) (v & 0x7f) | 0x80, out);
+    v >>= 7;
+  }
+  putc((int) v, out);
+}
+
+static void putInt(long v)
+{ putVarint(((unsigned long) v << 1) ^ (unsigned long) (v >> (sizeof(long) * 8 - 1)));
+}
+
+static void putString(const char * s, size_t len)
+{ putVarint(len);
+  fwrite(s, 1, len, out);
+}
+
+static void putLine(int n)
+{ putInt(n - lastLine);
+  lastLine = n;
+}
+
+static unsigned int hashString(const char * s)
+{ unsigned int h = 2166136261u;
+  for (; *s != '\0'; s++)
+    h = (h ^ (unsigned char) *s) * 16777619u;
+  return h;
+}
+
+static void growInterned(void)
+{ char ** oldStrings = interned;
+  int * oldIds = internedId;
+  int oldCap = capInterned, i;
+  capInterned = capInterned ? 2 * capInterned : 1024;
+  interned = (char **) calloc(capInterned, sizeof(char *));
+  internedId = (int *) malloc(capInterned * sizeof(int));
+  for (i = 0; i < oldCap; i++)
+    if (oldStrings[i] != NULL)
+    { unsigned int h = hashString(oldStrings[i]) & (capInterned - 1);
+      while (interned[h] != NULL) h = (h + 1) & (capInterned - 1);
+      interned[h] = oldStrings[i];
+      internedId[h] = oldIds[i];
+    }
+  free(oldStrings);
+  free(oldIds);
+}
+
+/* s, by reference if it was written before */
+static void putName(const char * s)
+{ unsigned int h;
+  if (s == NULL) s = "";
+  if (2 * (nInterned + 1) > capInterned) growInterned();
+  h = hashString(s) & (capInterned - 1);
+  while (interned[h] != NULL)
+  { if (strcmp(interned[h], s) == 0)
+    { putVarint(internedId[h] + 1);
+      return;
+    }
+    h = (h + 1) & (capInterned - 1);
+  }
+  interned[h] = copyString((char *) s);
+  internedId[h] = nInterned++;
+  putVarint(0);
+  putString(s, strlen(s));
+}
+
+static int stageIndex(FileDestination stage)
+{ int i = 0;
+  while (stage > 1)
+  { stage >>= 1;
+    i++;
+  }
+  return i;
+}
+
+/* text the stages got since the last record goes first */
+static void flushText(void)
+{ static const FileDestination stages[] = { LEX, SYN, TAB };
+  int i;
+  for (i = 0; i < 3; i++)
+  { size_t len;
+    char * text = takeStageBuffer(stages[i], &len);
+    if (text != NULL && len > 0)
+    { putc(RECORD(REC_TEXT, stageIndex(stages[i])), out);
+      putString(text, len);
+    }
+    free(text);
+  }
+}
+
+static void beginRecord(RecordType type)
+{ flushText();
+  putc(RECORD(type, stageIndex(currentState)), out);
+}
+
+int dumpOpen(const char * file, const char * source)
+{ out = fopen(file, "wb");
+  if (out == NULL) return FALSE;
+  setvbuf(out, NULL, _IOFBF, DUMP_BUFFER_SIZE);
+  fwrite(DUMP_MAGIC, 1, 4, out);
+  putString(source, strlen(source));
+  lastLine = 0;
+  routeStage(LEX | SYN | TAB, ROUTE_MEMORY);
+  return TRUE;
+}
+
+int dumpActive(void)
+{ return out != NULL;
+}
+
+void dumpEcho(int lineno, const char * line)
+{ beginRecord(REC_ECHO);
+  putLine(lineno);
+  putName(line);
+}
+
+static int hasLexeme(TokenType token)
+{ switch (token)
+  { case ELSE: case IF: case INT: case RETURN: case VOID: case WHILE:
+    case NUM: case ID: case ERROR:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+void dumpToken(int lineno, TokenType token, const char * lexeme)
+{ beginRecord(REC_TOKEN);
+  putLine(lineno);
+  putVarint(token);
+  /* symbols are listed without their lexeme */
+  if (hasLexeme(token)) putName(lexeme);
+}
+
+/* preorder: the node, its children, then along the siblings */
+static void writeNode(TreeNode * t)
+{ for (; t != NULL; t = t->sibling)
+  { int flags = 0, i;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (t->child[i] != NULL) flags |= NODE_CHILD(i);
+    if (t->sibling != NULL) flags |= NODE_SIBLING;
+    /* all the kinds share the union */
+    putc(NODE_BYTE(flags, t->nodekind, t->kind.stmt), out);
+    putLine(t->lineno);
+    if (t->nodekind == IdK) putName(t->attr.name);
+    else if (t->nodekind == ExpK && t->kind.exp == Constant) putInt(t->attr.val);
+    else if (t->nodekind == ExpK && t->kind.exp == Operator) putVarint(t->attr.op);
+    for (i = 0; i < MAXCHILDREN; i++)
+      writeNode(t->child[i]);
+  }
+}
+
+void dumpTree(TreeNode * tree)
+{ beginRecord(REC_TREE);
+  putc(tree != NULL, out);
+  writeNode(tree);
+}
+
+void dumpSymbolHeader(void)
+{ beginRecord(REC_SYMHEAD);
+}
+
+void dumpSymbol(const char * name, const char * scope, const char * idType,
+                const char * dataType, const int * lines, int nLines)
+{ int i;
+  beginRecord(REC_SYMBOL);
+  putName(name);
+  putName(scope);
+  putName(idType);
+  putName(dataType);
+  putVarint(nLines);
+  for (i = 0; i < nLines; i++)
+    putLine(lines[i]);
+}
+
+void dumpClose(void)
+{ int i;
+  if (out == NULL) return;
+  flushText();
+  putc(REC_END, out);
+  fclose(out);
+  out = NULL;
+  for (i = 0; i < capInterned; i++)
+    free(interned[i]);
+  free(interned);
+  free(internedId);
+  interned = NULL;
+  internedId = NULL;
+  capInterned = nInterned = 0;
+}
+
+/********************** rendering **********************/
+
+static FILE * in = NULL;
+static int truncated = FALSE;
+
+/* interned strings of the reader, by number */
+static char ** names = NULL;
+static int nNames = 0, capNames = 0;
+
+static int getByte(void)
+{ int c = getc(in);
+  if (c == EOF)
+  { truncated = TRUE;
+    return 0;
+  }
+  return c;
+}
+
+static unsigned long getVarint(void)
+{ unsigned long v = 0;
+  int shift = 0, c;
+  do
+  { c = getByte();
+    if (shift < (int) sizeof(long) * 8) v |= (unsigned long) (c & 0x7f) << shift;
+    shift += 7;
+  } while ((c & 0x80) && !truncated);
+  return v;
+}
+
+static long getInt(void)
+{ unsigned long v = getVarint();
+  return (long) (v >> 1) ^ -(long) (v & 1);
+}
+
+/* the caller frees the string */
+static char * getString(size_t * len)
+{ size_t n = getVarint();
+  char * s = (char *) malloc(n + 1);
+  if (s == NULL || (n > 0 && fread(s, 1, n, in) != n))
+  { truncated = TRUE;
+    if (s != NULL) s[0] = '\0';
+    if (len != NULL) *len = 0;
+    return s;
+  }
+  s[n] = '\0';
+  if (len != NULL) *len = n;
+  return s;
+}
+
+static int getLine(void)
+{ lastLine += (int) getInt();
+  return lastLine;
+}
+
+/* the string stays owned by the table of names */
+static char * getName(void)
+{ unsigned long k = getVarint();
+  if (k == 0)
+  { if (nNames == capNames)
+    { capNames = capNames ? 2 * capNames : 1024;
+      names = (char **) realloc(names, capNames * sizeof(char *));
+    }
+    names[nNames] = getString(NULL);
+    return names[nNames++];
+  }
+  if (k > (unsigned long) nNames)
+  { truncated = TRUE;
+    return "";
+  }
+  return names[k - 1];
+}
+
+static TreeNode * readNode(void)
+{ TreeNode * first = NULL, ** link = &first;
+  int more = TRUE;
+  while (more && !truncated)
+  { TreeNode * t = (TreeNode *) calloc(1, sizeof(TreeNode));
+    int b = getByte(), flags = NODE_FLAGS(b), i;
+    t->nodekind = (NodeKind) NODE_NODEKIND(b);
+    t->kind.stmt = (StmtKind) NODE_KIND(b);
+    t->lineno = getLine();
+    if (t->nodekind == IdK) t->attr.name = getName();
+    else if (t->nodekind == ExpK && t->kind.exp == Constant) t->attr.val = (int) getInt();
+    else if (t->nodekind == ExpK && t->kind.exp == Operator) t->attr.op = (TokenType) getVarint();
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (flags & NODE_CHILD(i))
+      { t->child[i] = readNode();
+        if (t->child[i] != NULL) t->child[i]->parent = t;
+      }
+    *link = t;
+    link = &t->sibling;
+    more = (flags & NODE_SIBLING) != 0;
+  }
+  return first;
+}
+
+static void freeNode(TreeNode * t)
+{ while (t != NULL)
+  { TreeNode * next = t->sibling;
+    int i;
+    for (i = 0; i < MAXCHILDREN; i++)
+      freeNode(t->child[i]);
+    free(t);
+    t = next;
+  }
+}
+
+int dumpRender(const char * file, const char * detailpath, FileDestination stages)
+{ char magic[4];
+  char * source;
+  int b;
+  in = fopen(file, "rb");
+  if (in == NULL) return FALSE;
+  truncated = FALSE;
+  lastLine = 0;
+  if (fread(magic, 1, 4, in) != 4 || memcmp(magic, DUMP_MAGIC, 4) != 0)
+  { fclose(in);
+    return FALSE;
+  }
+  source = getString(NULL);
+  if (! initializePrinter(detailpath, source, stages))
+  { fclose(in);
+    free(source);
+    return FALSE;
+  }
+  while (!truncated && (b = getByte()) != REC_END)
+  { /* the stage of the record is where pc() writes */
+    currentState = RECORD_STAGE(b);
+    switch (RECORD_TYPE(b))
+    { case REC_TEXT:
+      { size_t len;
+        char * text = getString(&len);
+        pf(currentState, "%.*s", (int) len, text);
+        free(text);
+        break;
+      }
+      case REC_ECHO:
+      { int n = getLine();
+        pc("%d: %s\n", n, getName()); /* as getToken echoes it */
+        break;
+      }
+      case REC_TOKEN:
+      { int n = getLine();
+        TokenType token = (TokenType) getVarint();
+        pc("\t%d: ", n); /* as getToken lists it */
+        printToken(token, hasLexeme(token) ? getName() : "");
+        break;
+      }
+      case REC_TREE:
+      { TreeNode * tree = getByte() ? readNode() : NULL;
+        printTree(tree);
+        freeNode(tree);
+        break;
+      }
+      case REC_SYMHEAD:
+        printSymHeader();
+        break;
+      case REC_SYMBOL:
+      { char * name = getName();
+        char * scope = getName();
+        char * idType = getName();
+        char * dataType = getName();
+        int n = (int) getVarint(), i;
+        int * lines = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+        for (i = 0; i < n && !truncated; i++)
+          lines[i] = getLine();
+        printSymRow(name, scope, idType, dataType, lines, i);
+        free(lines);
+        break;
+      }
+      default:
+        truncated = TRUE;
+        break;
+    }
+  }
+  closePrinter();
+  fclose(in);
+  free(source);
+  while (nNames > 0)
+    free(names[--nNames]);
+  return !truncated;
+}
@@ -0,0 +1,50 @@
+/****************************************************/
+/* File: dump.h                                     */
+/* Binary dump of the stage listings: token, tree   */
+/* and symbol records, rendered back to the text    */
+/* listings by tools/cmdump                         */
+/****************************************************/
+
+#ifndef _DUMP_H_
+#define _DUMP_H_
+
+#include "globals.h"
+
+/* While a dump is open the listings of LEX, SYN and TAB are
+ * kept in memory (see routeStage in log.h): the token listing,
+ * the syntax tree and the symbol table are written as records,
+ * and any other text of those stages (error messages) as text
+ * records in between, so each stage keeps its order. The text
+ * listings are still printed on stdout (see onlyStdout in log.h).
+ */
+
+/* starts dumping into file; source is the name of the compiled
+ * program, kept for the names of the rendered files.
+ * Returns FALSE if file cannot be created */
+int dumpOpen(const char * file, const char * source);
+
+/* TRUE while a dump is open */
+int dumpActive(void);
+
+/* a source line echoed in the token listing */
+void dumpEcho(int lineno, const char * line);
+
+/* a token of the token listing */
+void dumpToken(int lineno, TokenType token, const char * lexeme);
+
+/* the whole syntax tree, siblings of tree included */
+void dumpTree(TreeNode * tree);
+
+/* the header and one row of the symbol table */
+void dumpSymbolHeader(void);
+void dumpSymbol(const char * name, const char * scope, const char * idType,
+                const char * dataType, const int * lines, int nLines);
+
+/* writes the pending text and closes the dump */
+void dumpClose(void);
+
+/* renders the stages of file back to the text listings, through
+ * the routes set in log.c; returns FALSE if file is not a dump */
+int dumpRender(const char * file, const char * detailpath, FileDestination stages);
+
+#endif
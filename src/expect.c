@@ -0,0 +1,268 @@
+/****************************************************/
+/* File: expect.c                                   */
+/* In-process comparison of the stage outputs with  */
+/* the golden files                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "expect.h"
+
+#define NSTAGES 5
+
+/* one line kept for the comparison: normalized text and the
+ * number of the line in its file */
+typedef struct
+{ char * text;
+  int lineno;
+} Line;
+
+typedef struct
+{ Line * lines;
+  int n, cap;
+} Lines;
+
+typedef struct
+{ FileDestination stage;
+  const char * name;
+  char * golden;     /* file name */
+  FILE * copy;       /* writeDir: the stage file */
+  int active;        /* golden file found */
+  int unordered;
+  Lines expected;
+  int next;          /* ordered: next expected line */
+  Lines actual;      /* unordered: every line of the output */
+  char * partial;    /* output line not ended yet */
+  size_t nPartial, capPartial;
+  int lineno;        /* lines of output seen */
+  int mismatch;
+  int gotLine;       /* line of the output at the mismatch, 0 at its end */
+  char * got;
+  int expectedLine;  /* line of the golden file, 0 at its end */
+  char * wanted;
+} Comparison;
+
+static Comparison stages[NSTAGES] =
+{ { .stage = ER_, .name = "err" }, { .stage = LEX, .name = "lex" },
+  { .stage = SYN, .name = "syn" }, { .stage = TAB, .name = "tab" },
+  { .stage = GEN, .name = "gen" } };
+
+/* text as diff -Zb sees it: runs of white space become one
+ * space and trailing white space goes away; "" if blank */
+static char * normalize(const char * s, size_t len)
+{ char * t = (char *) malloc(len + 1);
+  size_t i, n = 0;
+  int space = FALSE;
+  for (i = 0; i < len; i++)
+  { if (isspace((unsigned char) s[i]))
+      space = TRUE;
+    else
+    { if (space) t[n++] = ' ';
+      t[n++] = s[i];
+      space = FALSE;
+    }
+  }
+  t[n] = '\0';
+  return t;
+}
+
+/* keeps the line unless it is blank (diff -B) */
+static void addLine(Lines * l, const char * s, size_t len, int lineno)
+{ char * text = normalize(s, len);
+  if (text[0] == '\0')
+  { free(text);
+    return;
+  }
+  if (l->n == l->cap)
+  { l->cap = l->cap ? 2 * l->cap : 256;
+    l->lines = (Line *) realloc(l->lines, l->cap * sizeof(Line));
+  }
+  l->lines[l->n].text = text;
+  l->lines[l->n].lineno = lineno;
+  l->n++;
+}
+
+static void freeLines(Lines * l)
+{ int i;
+  for (i = 0; i < l->n; i++)
+    free(l->lines[i].text);
+  free(l->lines);
+  l->lines = NULL;
+  l->n = l->cap = 0;
+}
+
+static int readGolden(const char * file, Lines * l)
+{ FILE * f = fopen(file, "r");
+  char * line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  int lineno = 0;
+  if (f == NULL) return FALSE;
+  while ((len = getline(&line, &cap, f)) >= 0)
+    addLine(l, line, (size_t) len, ++lineno);
+  free(line);
+  fclose(f);
+  return TRUE;
+}
+
+static void setMismatch(Comparison * c, int gotLine, const char * got,
+                        int expectedLine, const char * wanted)
+{ c->mismatch = TRUE;
+  c->gotLine = gotLine;
+  c->got = got ? copyString((char *) got) : NULL;
+  c->expectedLine = expectedLine;
+  c->wanted = wanted ? copyString((char *) wanted) : NULL;
+}
+
+/* one complete line of output */
+static void outputLine(Comparison * c, const char * s, size_t len)
+{ char * text;
+  c->lineno++;
+  if (c->unordered)
+  { addLine(&c->actual, s, len, c->lineno);
+    return;
+  }
+  if (c->mismatch) return;
+  text = normalize(s, len);
+  if (text[0] != '\0')
+  { if (c->next == c->expected.n)
+      setMismatch(c, c->lineno, text, 0, NULL);
+    else if (strcmp(text, c->expected.lines[c->next].text) != 0)
+      setMismatch(c, c->lineno, text, c->expected.lines[c->next].lineno,
+                  c->expected.lines[c->next].text);
+    else c->next++;
+  }
+  free(text);
+}
+
+/* SinkHook: splits the stream into lines */
+static void receive(FileDestination stage, const char * text, size_t len, void * data)
+{ Comparison * c = (Comparison *) data;
+  const char * end = text + len;
+  (void) stage;
+  if (c->copy != NULL) fwrite(text, 1, len, c->copy);
+  while (text < end)
+  { const char * nl = memchr(text, '\n', end - text);
+    size_t n = nl ? (size_t) (nl - text) : (size_t) (end - text);
+    if (c->nPartial + n > c->capPartial)
+    { while (c->nPartial + n > c->capPartial)
+        c->capPartial = c->capPartial ? 2 * c->capPartial : 256;
+      c->partial = (char *) realloc(c->partial, c->capPartial);
+    }
+    if (nl == NULL)
+    { memcpy(c->partial + c->nPartial, text, n);
+      c->nPartial += n;
+      return;
+    }
+    if (c->nPartial > 0)
+    { memcpy(c->partial + c->nPartial, text, n);
+      outputLine(c, c->partial, c->nPartial + n);
+      c->nPartial = 0;
+    }
+    else outputLine(c, text, n);
+    text = nl + 1;
+  }
+}
+
+void expectOpen(const char * dir, const char * source, FileDestination compared,
+                FileDestination unordered, const char * writeDir)
+{ const char * base = strrchr(source, '/') ? strrchr(source, '/') + 1 : source;
+  int baseLen = (int) strcspn(base, ".");
+  int i;
+  for (i = 0; i < NSTAGES; i++)
+  { Comparison * c = &stages[i];
+    char file[512];
+    if (!(filesOpened & c->stage)) continue;
+    snprintf(file, sizeof(file), "%s/%.*s_%s%s", dir, baseLen, base, c->name,
+             c->stage == GEN ? ".tm" : ".txt");
+    c->unordered = (unordered & c->stage) != 0;
+    c->active = (compared & c->stage) && readGolden(file, &c->expected);
+    c->golden = copyString(file);
+    if (c->active && writeDir != NULL)
+    { snprintf(file, sizeof(file), "%s/%.*s_%s%s", writeDir, baseLen, base, c->name,
+               c->stage == GEN ? ".tm" : ".txt");
+      c->copy = fopen(file, "w");
+      if (c->copy == NULL) perror(file);
+    }
+    if (c->active) hookStage(c->stage, receive, c);
+    else routeStage(c->stage, writeDir != NULL ? ROUTE_FILE : ROUTE_DISCARD);
+  }
+}
+
+static int compareLines(const void * a, const void * b)
+{ return strcmp(((const Line *) a)->text, ((const Line *) b)->text);
+}
+
+/* removes repeated lines of a sorted list */
+static void unique(Lines * l)
+{ int i, n = 0;
+  for (i = 0; i < l->n; i++)
+  { if (n > 0 && strcmp(l->lines[i].text, l->lines[n - 1].text) == 0)
+      free(l->lines[i].text);
+    else l->lines[n++] = l->lines[i];
+  }
+  l->n = n;
+}
+
+/* as sets: the first line (in order of the files) that only
+ * one side has */
+static void compareSets(Comparison * c)
+{ Lines * e = &c->expected, * a = &c->actual;
+  Line * onlyGot = NULL, * onlyWanted = NULL;
+  int i = 0, j = 0;
+  qsort(e->lines, e->n, sizeof(Line), compareLines);
+  qsort(a->lines, a->n, sizeof(Line), compareLines);
+  unique(e);
+  unique(a);
+  while (i < a->n || j < e->n)
+  { int cmp = i == a->n ? 1 : j == e->n ? -1 : strcmp(a->lines[i].text, e->lines[j].text);
+    if (cmp == 0) { i++; j++; }
+    else if (cmp < 0)
+    { if (onlyGot == NULL || a->lines[i].lineno < onlyGot->lineno) onlyGot = &a->lines[i];
+      i++;
+    }
+    else
+    { if (onlyWanted == NULL || e->lines[j].lineno < onlyWanted->lineno) onlyWanted = &e->lines[j];
+      j++;
+    }
+  }
+  if (onlyGot != NULL || onlyWanted != NULL)
+    setMismatch(c, onlyGot ? onlyGot->lineno : 0, onlyGot ? onlyGot->text : NULL,
+                onlyWanted ? onlyWanted->lineno : 0, onlyWanted ? onlyWanted->text : NULL);
+}
+
+int expectFinish(void)
+{ int i, differ = 0, compared = 0;
+  for (i = 0; i < NSTAGES; i++)
+  { Comparison * c = &stages[i];
+    if (!c->active) continue;
+    compared++;
+    if (c->nPartial > 0) outputLine(c, c->partial, c->nPartial);
+    if (c->unordered) compareSets(c);
+    else if (!c->mismatch && c->next < c->expected.n)
+      setMismatch(c, 0, NULL, c->expected.lines[c->next].lineno,
+                  c->expected.lines[c->next].text);
+    if (c->mismatch)
+    { differ++;
+      fprintf(stderr,"expect %s: differs%s\n", c->name, c->unordered ? " (as sets of lines)" : "");
+      if (c->got) fprintf(stderr,"  output line %d: %s\n", c->gotLine, c->got);
+      else fprintf(stderr,"  output: %s\n", c->unordered ? "(no extra line)" : "(ended)");
+      if (c->wanted) fprintf(stderr,"  %s line %d: %s\n", c->golden, c->expectedLine, c->wanted);
+      else fprintf(stderr,"  %s: %s\n", c->golden, c->unordered ? "(no missing line)" : "(ended)");
+    }
+  }
+  for (i = 0; i < NSTAGES; i++)
+  { Comparison * c = &stages[i];
+    Comparison clean = { .stage = c->stage, .name = c->name };
+    if (c->copy != NULL) fclose(c->copy);
+    free(c->golden);
+    free(c->got);
+    free(c->wanted);
+    free(c->partial);
+    freeLines(&c->expected);
+    freeLines(&c->actual);
+    *c = clean;
+  }
+  fprintf(stderr,"expect: %d of %d stages match\n", compared - differ, compared);
+  return differ;
+}
@@ -0,0 +1,31 @@
+/****************************************************/
+/* File: expect.h                                   */
+/* In-process comparison of the stage outputs with  */
+/* the golden files (mycmcomp --expect=<dir>)       */
+/****************************************************/
+
+#ifndef _EXPECT_H_
+#define _EXPECT_H_
+
+#include "globals.h"
+
+/* Lines are compared as diff -ZbB does: trailing white space
+ * is ignored, runs of white space match a single space and
+ * blank lines are skipped. Stages in unordered are compared as
+ * sets of lines, as compare_diffs.py does for the tab files.
+ */
+
+/* streams every stage opened by initializePrinter into a
+ * comparator against <dir>/<name>_<stage>.txt (_gen.tm), where
+ * name is the base name of source. Stages not in compared or
+ * without a golden file are skipped and their output dropped. If
+ * writeDir is not NULL the stages also go to their files in
+ * writeDir, as they would without a comparison (mycmcomp --watch) */
+void expectOpen(const char * dir, const char * source, FileDestination compared,
+                FileDestination unordered, const char * writeDir);
+
+/* after closePrinter: reports the first mismatching line of each
+ * stage to stderr; returns the number of stages that differ */
+int expectFinish(void);
+
+#endif
@@ -0,0 +1,306 @@
+/****************************************************/
+/* File: frame.c                                    */
+/* Frame layout for the C- compiler                 */
+/* Offsets follow the ScopeNode tree: a block's     */
+/* locals start below its parent's, and sibling     */
+/* blocks start at the same slot                    */
+/****************************************************/
+
+#include "globals.h"
+#include "frame.h"
+#include "callgraph.h"
+#include "util.h"
+#include "phase.h"
+
+#define NAMES_SIZE 211
+#define SHIFT 4
+
+/* declarations of one scope, in source order */
+typedef struct
+{ TreeNode ** items;
+  int n, cap;
+} DeclList;
+
+/* declarations visible by name */
+typedef struct nameRec
+{ TreeNode * decl;
+  struct nameRec * next;
+} * NameList;
+
+static FrameInfo * frames = NULL;
+static FrameInfo * lastFrame = NULL;
+static int globalWords = 0;
+
+/* functions left out because main never calls them */
+static char ** skipped = NULL;
+static int nSkipped = 0, capSkipped = 0;
+
+/* declarations of the current function, indexed by scope id */
+static DeclList * byScope = NULL;
+static int byScopeCap = 0;
+
+static NameList localNames[NAMES_SIZE];
+static NameList globalNames[NAMES_SIZE];
+
+/* uses of the current function, resolved after the layout */
+static TreeNode ** uses = NULL;
+static int nUses = 0, usesCap = 0;
+
+static int hash(const char * key)
+{ unsigned int temp = 0;
+  int i = 0;
+  while (key[i] != '\0')
+  { temp = ((temp << SHIFT) + key[i]) % NAMES_SIZE;
+    ++i;
+  }
+  return temp;
+}
+
+static void addName(NameList * table, TreeNode * decl)
+{ int h = hash(decl->attr.name);
+  NameList l = (NameList) malloc(sizeof(*l));
+  l->decl = decl;
+  l->next = table[h];
+  table[h] = l;
+}
+
+static void clearNames(NameList * table)
+{ int i;
+  for (i = 0; i < NAMES_SIZE; i++)
+  { while (table[i] != NULL)
+    { NameList next = table[i]->next;
+      free(table[i]);
+      table[i] = next;
+    }
+  }
+}
+
+/* words taken by a declaration: local arrays hold their elements,
+ * array parameters only the address of the caller's array */
+static int declWords(TreeNode * t)
+{ if (t->kind.id == Array && t->child[0] != NULL)
+    return t->child[0]->attr.val;
+  return 1;
+}
+
+static int isDecl(TreeNode * t)
+{ return t->nodekind == IdK
+      && (t->kind.id == Variable || t->kind.id == Array)
+      && t->parent != NULL && t->parent->nodekind == TypeK;
+}
+
+static void declareLocal(TreeNode * t)
+{ int id = t->scopeNode ? t->scopeNode->scope->id : 0;
+  DeclList * l;
+  if (id < 0) id = 0;
+  if (id >= byScopeCap)
+  { int cap = byScopeCap ? byScopeCap : 64;
+    while (cap <= id) cap *= 2;
+    byScope = (DeclList *) realloc(byScope, cap * sizeof(DeclList));
+    memset(byScope + byScopeCap, 0, (cap - byScopeCap) * sizeof(DeclList));
+    byScopeCap = cap;
+  }
+  l = &byScope[id];
+  if (l->n == l->cap)
+  { l->cap = l->cap ? 2 * l->cap : 4;
+    l->items = (TreeNode **) realloc(l->items, l->cap * sizeof(TreeNode *));
+  }
+  l->items[l->n++] = t;
+  addName(localNames, t);
+}
+
+/* finds the innermost declaration of a use among the locals
+ * whose scope encloses it, else among the globals */
+static TreeNode * resolve(TreeNode * t)
+{ TreeNode * best = NULL;
+  NameList l;
+  int h = hash(t->attr.name);
+  for (l = localNames[h]; l != NULL; l = l->next)
+  { TreeNode * d = l->decl;
+    if (strcmp(d->attr.name, t->attr.name) != 0) continue;
+    if (t->scopeNode != NULL && d->scopeNode != NULL
+        && !isInsideScopeNode(t->scopeNode, d->scopeNode)) continue;
+    if (best == NULL || (d->scopeNode != NULL && best->scopeNode != NULL
+                         && d->scopeNode->pre > best->scopeNode->pre))
+      best = d;
+  }
+  if (best != NULL) return best;
+  for (l = globalNames[h]; l != NULL; l = l->next)
+    if (strcmp(l->decl->attr.name, t->attr.name) == 0)
+      return l->decl;
+  return NULL;
+}
+
+/* collects the declarations and uses of a function body */
+static void collect(TreeNode * t)
+{ int i;
+  for (; t != NULL; t = t->sibling)
+  { if (t->nodekind == IdK && (t->kind.id == Variable || t->kind.id == Array))
+    { if (isDecl(t))
+        declareLocal(t);
+      else
+      { if (nUses == usesCap)
+        { usesCap = usesCap ? 2 * usesCap : 64;
+          uses = (TreeNode **) realloc(uses, usesCap * sizeof(TreeNode *));
+        }
+        t->decl = resolve(t);
+        uses[nUses++] = t;
+      }
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+      collect(t->child[i]);
+  }
+}
+
+/* lays out scope s starting at slot next (growing down) and
+ * returns the lowest slot taken by s and its nested blocks */
+static int layoutScope(ScopeNode * s, int next, FrameInfo * f)
+{ int i, deepest;
+  int id = s->scope->id;
+  if (id >= 0 && id < byScopeCap)
+  { DeclList * l = &byScope[id];
+    for (i = 0; i < l->n; i++)
+    { int words = declWords(l->items[i]);
+      l->items[i]->offset = next - words + 1;
+      next -= words;
+      f->locals += words;
+    }
+    l->n = 0;
+  }
+  deepest = next;
+  for (i = 0; i < s->numChildren; i++)
+  { int d = layoutScope(s->children[i], next, f);
+    if (d < deepest) deepest = d;
+  }
+  return deepest;
+}
+
+static void layoutFunction(TreeNode * fun, ScopeNode * scope)
+{ FrameInfo * f = (FrameInfo *) malloc(sizeof(FrameInfo));
+  TreeNode * p;
+  int i, deepest;
+
+  f->name = copyString(fun->attr.name);
+  f->params = 0;
+  f->locals = 0;
+  f->next = NULL;
+  for (p = fun->child[0]; p != NULL; p = p->sibling)
+    f->params++;
+
+  nUses = 0;
+  collect(fun->child[0]);
+  collect(fun->child[1]);
+  if (scope != NULL)
+    deepest = layoutScope(scope, FRAME_FIRST_SLOT, f);
+  else
+  { /* no scope tree: every declaration gets its own slot */
+    deepest = FRAME_FIRST_SLOT;
+    for (i = 0; i < byScopeCap; i++)
+    { int j;
+      for (j = 0; j < byScope[i].n; j++)
+      { int words = declWords(byScope[i].items[j]);
+        byScope[i].items[j]->offset = deepest - words + 1;
+        deepest -= words;
+        f->locals += words;
+      }
+      byScope[i].n = 0;
+    }
+  }
+  f->locals -= f->params;
+  f->size = FRAME_HEADER_WORDS + (FRAME_FIRST_SLOT - deepest);
+
+  for (i = 0; i < nUses; i++)
+    if (uses[i]->decl != NULL)
+      uses[i]->offset = uses[i]->decl->offset;
+  clearNames(localNames);
+
+  if (lastFrame == NULL) frames = f;
+  else lastFrame->next = f;
+  lastFrame = f;
+}
+
+/* the frames and names of the previous compilation of the run */
+static void freeFrames(void)
+{ int i;
+  while (frames != NULL)
+  { FrameInfo * next = frames->next;
+    free(frames->name);
+    free(frames);
+    frames = next;
+  }
+  lastFrame = NULL;
+  for (i = 0; i < nSkipped; i++)
+    free(skipped[i]);
+  nSkipped = 0;
+}
+
+void layoutFrames(TreeNode * syntaxTree)
+{ TreeNode * t;
+  int nextFunction = 0;
+
+  freeFrames();
+  globalWords = 0;
+  clearNames(globalNames);
+
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+  { TreeNode * id = t->child[0];
+    if (t->nodekind != TypeK || id == NULL || id->nodekind != IdK) continue;
+    if (id->kind.id == Function)
+    { /* functions open the scopes of the root, in source order */
+      ScopeNode * scope = NULL;
+      if (scopeTree != NULL && nextFunction < scopeTree->numChildren)
+        scope = scopeTree->children[nextFunction++];
+      if (cgIsReachable(id->attr.name))
+      { if (phaseTracing())
+        { int nodes = countNodes(t);
+          double start = phaseSpanStart();
+          layoutFunction(id, scope);
+          phaseSpan(id->attr.name, nodes, start);
+        }
+        else layoutFunction(id, scope);
+      }
+      else
+      { if (nSkipped == capSkipped)
+        { capSkipped = capSkipped ? 2 * capSkipped : 16;
+          skipped = (char **) realloc(skipped, capSkipped * sizeof(char *));
+        }
+        skipped[nSkipped++] = copyString(id->attr.name);
+      }
+    }
+    else
+    { id->offset = globalWords;
+      globalWords += declWords(id);
+      addName(globalNames, id);
+    }
+  }
+}
+
+FrameInfo * frameInfos(void)
+{ return frames;
+}
+
+int globalDataSize(void)
+{ return globalWords;
+}
+
+void printFrameReport(FILE * out)
+{ FrameInfo * f;
+  fprintf(out,"\nFrame layout:\n\n");
+  fprintf(out,"Function        Params  Locals  Unshared  Frame  Max depth\n");
+  fprintf(out,"--------------  ------  ------  --------  -----  ---------\n");
+  for (f = frames; f != NULL; f = f->next)
+  { int unshared = FRAME_HEADER_WORDS + f->params + f->locals;
+    /* dMem[0] holds the top address; globals sit at the bottom */
+    int depth = (FRAME_DADDR_SIZE - 1 - globalWords) / f->size;
+    fprintf(out,"%-14s  %6d  %6d  %8d  %5d  %9d\n",
+            f->name, f->params, f->locals, unshared, f->size, depth);
+  }
+  fprintf(out,"globals: %d words\n", globalWords);
+  if (nSkipped > 0)
+  { int i;
+    fprintf(out,"unreachable (no frame):");
+    for (i = 0; i < nSkipped; i++)
+      fprintf(out," %s", skipped[i]);
+    fprintf(out,"\n");
+  }
+}
@@ -0,0 +1,53 @@
+/****************************************************/
+/* File: frame.h                                    */
+/* Frame layout for the C- compiler: assigns data   */
+/* addresses to parameters, locals and globals      */
+/****************************************************/
+
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+#include "globals.h"
+
+/* TM activation record, fp = reg 2:
+ *    0(fp)  old fp (control link)
+ *   -1(fp)  return address
+ *   -2(fp)  first parameter, then the other parameters and the locals
+ * temporaries are pushed below the last local.
+ */
+#define FRAME_OFS_RETADDR  -1
+#define FRAME_FIRST_SLOT   -2
+#define FRAME_HEADER_WORDS 2
+
+/* words of data memory of the TM machine (DADDR_SIZE in tm.c) */
+#define FRAME_DADDR_SIZE 1024
+
+typedef struct frameInfo
+{ char * name;   /* function name (a copy, kept after freeTree) */
+  int params;    /* words of parameters */
+  int locals;    /* words of all locals, as if none shared a slot */
+  int size;      /* frame words: header + params + locals after sharing */
+  struct frameInfo * next;
+} FrameInfo;
+
+/* Function layoutFrames assigns an offset to every var/array
+ * declaration of the tree (fp-relative for params and locals,
+ * gp-relative for globals) and copies it to the uses, which
+ * also get their declaration in 'decl'.
+ * Blocks that are siblings in the ScopeNode tree never live at
+ * the same time, so their locals share the same slots.
+ * Functions the call graph marks unreachable get no frame.
+ */
+void layoutFrames(TreeNode * syntaxTree);
+
+/* frames of the functions laid out, in source order; valid
+ * until the next layoutFrames */
+FrameInfo * frameInfos(void);
+
+/* words of global data */
+int globalDataSize(void);
+
+/* prints the frame size of each function */
+void printFrameReport(FILE * out);
+
+#endif
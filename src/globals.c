@@ -0,0 +1,26 @@
+/****************************************************/
+/* File: globals.c                                  */
+/* Global variables of globals.h, kept out of       */
+/* main.c so that libcminus carries them            */
+/****************************************************/
+
+#include "globals.h"
+
+/* allocate global variables */
+int lineno = 1;
+FILE * source;
+FILE * listing;
+FILE * code;
+FILE * redundant_source;
+
+ScopeNode *scopeTree;
+ScopeNode *currentScope;
+
+/* allocate and set tracing flags (--trace=LIST) */
+int EchoSource = TRUE;
+int TraceScan = TRUE;
+int TraceParse = TRUE;
+int TraceAnalyze = FALSE;
+int TraceCode = FALSE;
+
+int Error = FALSE;
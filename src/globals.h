@@ -15,6 +15,7 @@
 #include <string.h>
 #include "log.h"
 #include "scopetree.h"
+#include "memtrack.h"
 
 #ifndef YYPARSER
 #include "parser.h"
@@ -81,6 +82,9 @@ typedef struct treeNode
              int val;
              char * name; } attr;
      ExpType type; /* for type checking of exps */
+     int offset; /* data address of vars/arrays: fp-relative for locals,
+                    gp-relative for globals (see frame.c) */
+     struct treeNode * decl; /* declaration a var/array use refers to */
    } TreeNode;
 
 /**************************************************/
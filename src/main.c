@@ -7,104 +7,348 @@
 
 #include "globals.h"
 #include "scopetree.h"
+#include <limits.h>
 
-/* set NO_PARSE to TRUE to get a scanner-only compiler */
-#define NO_PARSE FALSE
-/* set NO_ANALYZE to TRUE to get a parser-only compiler */
-#define NO_ANALYZE FALSE
-
-/* set NO_CODE to TRUE to get a compiler that does not
- * generate code
+/* NO_CODE is TRUE while the tree has no code generator
+ * (cgen.c); which phases run is chosen at run time with
+ * --lex-only, -fsyntax-only and --no-codegen
  */
 #define NO_CODE TRUE
 
 #include "util.h"
-#if NO_PARSE
+#include "diag.h"
+#include "dump.h"
+#include "expect.h"
+#include "phase.h"
+#include "serve.h"
+#include "watch.h"
+#include "cache.h"
 #include "scan.h"
-#else
 #include "parse.h"
-#if !NO_ANALYZE
 #include "analyze.h"
+#include "symtab.h"
+#include "frame.h"
+#include "callgraph.h"
 #if !NO_CODE
 #include "cgen.h"
 #endif
-#endif
-#endif
 
-/* allocate global variables */
-int lineno = 1;
-FILE * source;
-FILE * listing;
-FILE * code;
-FILE * redundant_source;
+/* the global variables are allocated in globals.c */
 
-ScopeNode *scopeTree;
-ScopeNode *currentScope;
+/* report flags, set from the command line */
+static int symtabStats = FALSE; /* --symtab-stats[=json] */
+static int symtabStatsJson = FALSE;
+static int frameReport = FALSE; /* --frame-report */
+static int analysisJobs = 1; /* --jobs=N */
+static int callGraph = FALSE; /* --callgraph[=dot|json] */
+static int callGraphJson = FALSE;
+static int maxErrors = 0; /* --max-errors=N, 0 = no limit */
+static int binaryDump = FALSE; /* --binary-dump */
+static int timeReport = FALSE; /* --time-report[=json] */
+static int timeReportJson = FALSE;
+static int memReport = FALSE; /* --mem-report[=json] */
+static int memReportJson = FALSE;
+static const char * traceEventsFile = NULL; /* --trace-events=<file> */
 
-/* allocate and set tracing flags */
-int EchoSource = TRUE;
-int TraceScan = TRUE;
-int TraceParse = TRUE;
-int TraceAnalyze = FALSE;
-int TraceCode = FALSE;
+/* the last phase that runs */
+typedef enum
+{ RUN_LEX,      /* --lex-only */
+  RUN_PARSE,    /* -fsyntax-only */
+  RUN_ANALYZE,  /* --no-codegen */
+  RUN_CODEGEN
+} LastPhase;
 
-int Error = FALSE;
+static LastPhase lastPhase = RUN_CODEGEN;
+static FileDestination logFiles = 0; /* --log=MASK, 0 = the files of the phases that run */
+static DiagFormat diagFormat = DIAG_TEXT; /* --diag-format */
 
-int main( int argc, char * argv[] )
-{ TreeNode * syntaxTree;
-  
-    //// opening sources ////
-    char pgm[120]; /* source code file name */
-    if ((argc < 2) || (argc > 3))
-    { fprintf(stderr,"usage: %s <filename> [<detailpath>]\n",argv[0]);
+static const char * expectDir = NULL; /* --expect=<dir> */
+static FileDestination expectUnordered = 0; /* --expect-unordered=STAGES */
+static const char * watchDetailDir = NULL; /* --watch: the stages are written here, compared or not */
+static const char * cacheDirectory = NULL; /* --cache=<dir> */
+static long long cacheSize = 256LL << 20; /* --cache-size=N[K|M|G] */
+static int cacheStats = FALSE; /* --cache-stats */
+static int useCache = FALSE; /* the outputs of compile() go through the cache */
+static char * cacheOptions = NULL; /* the options that change the outputs, part of the key */
+
+/* the stages named by the first len characters of name; 0 if none */
+static FileDestination stageByName(const char * name, size_t len)
+{ static const struct { const char * name; FileDestination stages; } stages[] =
+  { { "err", ER_ }, { "lex", LEX }, { "syn", SYN }, { "tab", TAB }, { "gen", GEN },
+    { "all", ER_ | LEX | SYN | TAB | GEN },
+    /* the masks of log.h */
+    { "ER_", ER_ }, { "LEX", LEX }, { "LER", LER }, { "SYN", SYN }, { "SER", SER },
+    { "TAB", TAB }, { "TER", TER }, { "GEN", GEN }, { "GER", GER },
+    { "UP2SYN", UP2SYN }, { "UP2TAB", UP2TAB }, { "LOGALL", LOGALL } };
+  int i;
+  for (i = 0; i < (int) (sizeof(stages) / sizeof(stages[0])); i++)
+    if (strlen(stages[i].name) == len && strncmp(name,stages[i].name,len) == 0)
+      return stages[i].stages;
+  return 0;
+}
+
+/* --route=STAGE=KIND: where the output of a stage goes */
+static int parseRoute(const char * arg)
+{ const char * kind = strchr(arg,'=');
+  FileDestination stages;
+  SinkRoute route;
+  if (kind == NULL) return FALSE;
+  if (strcmp(kind + 1,"file") == 0) route = ROUTE_FILE;
+  else if (strcmp(kind + 1,"stdout") == 0) route = ROUTE_STDOUT;
+  else if (strcmp(kind + 1,"null") == 0) route = ROUTE_DISCARD;
+  else return FALSE;
+  stages = stageByName(arg,kind - arg);
+  if (stages == 0) return FALSE;
+  routeStage(stages,route);
+  return TRUE;
+}
+
+/* a list of stages split by one of the separators
+ * (e.g. "," or "|"); 0 if a name is unknown */
+static FileDestination parseStages(const char * list, const char * separators)
+{ FileDestination stages = 0;
+  while (*list != '\0')
+  { size_t len = strcspn(list,separators);
+    FileDestination s = stageByName(list,len);
+    if (s == 0) return 0;
+    stages |= s;
+    list += len;
+    if (*list != '\0') list++;
+  }
+  return stages;
+}
+
+/* --trace=LIST: the listings to print, all others off */
+static int parseTrace(const char * list)
+{ EchoSource = TraceScan = TraceParse = TraceAnalyze = TraceCode = FALSE;
+  if (strcmp(list,"none") == 0) return TRUE;
+  while (*list != '\0')
+  { size_t len = strcspn(list,",");
+    int all = len == 3 && strncmp(list,"all",3) == 0;
+    int known = all;
+    if (all || (len == 4 && strncmp(list,"echo",4) == 0)) known = EchoSource = TRUE;
+    if (all || (len == 4 && strncmp(list,"scan",4) == 0)) known = TraceScan = TRUE;
+    if (all || (len == 5 && strncmp(list,"parse",5) == 0)) known = TraceParse = TRUE;
+    if (all || (len == 7 && strncmp(list,"analyze",7) == 0)) known = TraceAnalyze = TRUE;
+    if (all || (len == 4 && strncmp(list,"code",4) == 0)) known = TraceCode = TRUE;
+    if (! known) return FALSE;
+    list += len;
+    if (*list == ',') list++;
+  }
+  return TRUE;
+}
+
+static void usage(const char * prog)
+{ fprintf(stderr,"usage: %s [options] <filename> [<detailpath>]\n",prog);
+  fprintf(stderr,"       %s [options] <filename>... -d <detailpath>\n",prog);
+  fprintf(stderr,"       %s [options] --serve <socket>\n",prog);
+  fprintf(stderr,"       %s [options] --watch <dir> [-d <detailpath>]\n",prog);
+  fprintf(stderr,"options:\n");
+  fprintf(stderr,"  --lex-only             only scan the source\n");
+  fprintf(stderr,"  -fsyntax-only          only scan and parse the source\n");
+  fprintf(stderr,"  --no-codegen           stop after the semantic analysis\n");
+  fprintf(stderr,"  --trace=LIST           listings to print: echo, scan, parse, analyze, code,\n");
+  fprintf(stderr,"                         all or none (default echo,scan,parse)\n");
+  fprintf(stderr,"  --log=MASK             stage files to write, e.g. LER, UP2TAB or lex|syn\n");
+  fprintf(stderr,"                         (default: those of the phases that run)\n");
+  fprintf(stderr,"  --symtab-stats[=json]  print symbol table statistics to stderr\n");
+  fprintf(stderr,"  --frame-report         print the frame size of each function to stderr\n");
+  fprintf(stderr,"  --jobs=N               analyze function bodies with N threads\n");
+  fprintf(stderr,"  --time-report[=json]   print wall and CPU time and output bytes per phase to stderr\n");
+  fprintf(stderr,"  --trace-events=FILE    write Chrome trace events of the phases and functions\n");
+  fprintf(stderr,"  --mem-report[=json]    print allocations and peak memory per phase to stderr\n");
+  fprintf(stderr,"  --callgraph[=dot|json] print the call graph to stderr (default dot)\n");
+  fprintf(stderr,"  --max-errors=N         stop after the phase that reports N errors\n");
+  fprintf(stderr,"  --diag-format=text|json  format of error messages (default text)\n");
+  fprintf(stderr,"  --route=STAGE=KIND     send a stage (err, lex, syn, tab, gen or all)\n");
+  fprintf(stderr,"                         to its file (default), stdout or null\n");
+  fprintf(stderr,"  --no-stdout            do not echo the compiler output on stdout\n");
+  fprintf(stderr,"  --async-log            write the stage files from a background thread\n");
+  fprintf(stderr,"  --binary-dump          write the lex, syn and tab listings as binary records\n");
+  fprintf(stderr,"                         in <detailpath>/<name>.cmb (render with cmdump)\n");
+  fprintf(stderr,"  --expect=DIR           compare each stage with DIR/<name>_<stage>.txt as\n");
+  fprintf(stderr,"                         diff -ZbB does, instead of writing it; exit 1 if any differs\n");
+  fprintf(stderr,"  --expect-unordered=STAGES  compare these stages (e.g. tab) as sets of lines\n");
+  fprintf(stderr,"  --serve SOCKET         compile the requests of cmclient on a Unix socket until\n");
+  fprintf(stderr,"                         cmclient --quit; the options are those of each request\n");
+  fprintf(stderr,"  --cache=DIR            reuse the outputs of a source compiled before with the same\n");
+  fprintf(stderr,"                         options and compiler (stage files hard linked from DIR)\n");
+  fprintf(stderr,"  --cache-size=N[K|M|G]  entries kept in the cache, least recently used out (default 256M)\n");
+  fprintf(stderr,"  --cache-stats          print the hits, misses and size of the cache to stderr\n");
+  fprintf(stderr,"  --watch DIR            compile the .cm files of DIR, then each again when it is\n");
+  fprintf(stderr,"                         saved; stage files in -d (default /tmp/), compared\n");
+  fprintf(stderr,"                         with --expect=DIR if given; one ok/FAIL line per file\n");
+  exit(1);
+}
+
+/* applies one option of the command line (or of a --serve
+ * request); FALSE if it is unknown or its value is wrong */
+static int parseOption(const char * arg)
+{ if (strcmp(arg,"--symtab-stats") == 0)
+    symtabStats = TRUE;
+  else if (strcmp(arg,"--symtab-stats=json") == 0)
+    symtabStats = symtabStatsJson = TRUE;
+  else if (strcmp(arg,"--frame-report") == 0)
+    frameReport = TRUE;
+  else if (strcmp(arg,"--time-report") == 0)
+    timeReport = TRUE;
+  else if (strcmp(arg,"--time-report=json") == 0)
+    timeReport = timeReportJson = TRUE;
+  else if (strncmp(arg,"--trace-events=",15) == 0 && arg[15] != '\0')
+    traceEventsFile = arg + 15;
+  else if (strcmp(arg,"--mem-report") == 0)
+    memReport = TRUE;
+  else if (strcmp(arg,"--mem-report=json") == 0)
+    memReport = memReportJson = TRUE;
+  else if (strcmp(arg,"--callgraph") == 0 || strcmp(arg,"--callgraph=dot") == 0)
+    callGraph = TRUE;
+  else if (strcmp(arg,"--callgraph=json") == 0)
+    callGraph = callGraphJson = TRUE;
+  else if (strncmp(arg,"--max-errors=",13) == 0)
+  { maxErrors = atoi(arg + 13);
+    if (maxErrors < 1) return FALSE;
+  }
+  else if (strcmp(arg,"--diag-format=text") == 0)
+    diagFormat = DIAG_TEXT;
+  else if (strcmp(arg,"--diag-format=json") == 0)
+    diagFormat = DIAG_JSON;
+  else if (strncmp(arg,"--route=",8) == 0)
+  { if (! parseRoute(arg + 8)) return FALSE;
+  }
+  else if (strcmp(arg,"--no-stdout") == 0)
+    mirrorStdout(FALSE);
+  else if (strcmp(arg,"--async-log") == 0)
+    asyncWriter(TRUE);
+  else if (strcmp(arg,"--binary-dump") == 0)
+    binaryDump = TRUE;
+  else if (strncmp(arg,"--expect=",9) == 0 && arg[9] != '\0')
+    expectDir = arg + 9;
+  else if (strncmp(arg,"--expect-unordered=",19) == 0)
+  { expectUnordered = parseStages(arg + 19,",");
+    if (expectUnordered == 0) return FALSE;
+  }
+  else if (strncmp(arg,"--cache=",8) == 0 && arg[8] != '\0')
+    cacheDirectory = arg + 8;
+  else if (strncmp(arg,"--cache-size=",13) == 0)
+  { char * end;
+    cacheSize = strtoll(arg + 13,&end,10);
+    if (*end == 'K' || *end == 'k') cacheSize <<= 10, end++;
+    else if (*end == 'M' || *end == 'm') cacheSize <<= 20, end++;
+    else if (*end == 'G' || *end == 'g') cacheSize <<= 30, end++;
+    if (*end != '\0' || cacheSize <= 0) return FALSE;
+  }
+  else if (strcmp(arg,"--cache-stats") == 0)
+    cacheStats = TRUE;
+  else if (strcmp(arg,"--lex-only") == 0)
+    lastPhase = RUN_LEX;
+  else if (strcmp(arg,"-fsyntax-only") == 0)
+    lastPhase = RUN_PARSE;
+  else if (strcmp(arg,"--no-codegen") == 0)
+    lastPhase = RUN_ANALYZE;
+  else if (strncmp(arg,"--trace=",8) == 0)
+  { if (! parseTrace(arg + 8)) return FALSE;
+  }
+  else if (strncmp(arg,"--log=",6) == 0)
+  { logFiles = parseStages(arg + 6,"|,");
+    if (logFiles == 0) return FALSE;
+  }
+  else if (strncmp(arg,"--jobs=",7) == 0)
+  { analysisJobs = atoi(arg + 7);
+    if (analysisJobs < 1) return FALSE;
+  }
+  else return FALSE;
+  return TRUE;
+}
+
+/* the stage files written: --log, or those of the phases that run */
+static FileDestination stageFiles(void)
+{ if (logFiles != 0) return logFiles;
+  return lastPhase == RUN_LEX ? LER : lastPhase == RUN_PARSE ? UP2SYN :
+         lastPhase == RUN_ANALYZE ? UP2TAB : LOGALL;
+}
+
+/* compiles pgm, already open as source and redundant_source,
+ * and closes them; the state of the last file is reset first.
+ * Returns 1 if an output differs from --expect, 0 otherwise */
+static int compileSource(const char * pgm, const char * detailpath)
+{ TreeNode * syntaxTree = NULL;
+  int status = 0;
+
+  /* per compilation state of the last file */
+  Error = FALSE;
+  resetScanner();
+  diagReset();
+  diagSetMaxErrors(maxErrors);
+  diagSetFormat(diagFormat);
+  freeScopeArena();
+
+  if (! initializePrinter(detailpath, pgm, stageFiles()))// init logger in /lib/log.c
+  { fclose(source);
+    fclose(redundant_source);
+    return 1;
+  }
+  if (expectDir != NULL) /* no gen output to compare without a code generator */
+    expectOpen(expectDir,pgm,NO_CODE ? LOGALL & ~GEN : LOGALL,expectUnordered,watchDetailDir);
+  if (binaryDump)
+  { char dumpfile[512];
+    const char * base = strrchr(pgm,'/') ? strrchr(pgm,'/') + 1 : pgm;
+    snprintf(dumpfile,sizeof(dumpfile),"%s/%.*s.cmb",detailpath,(int) strcspn(base,"."),base);
+    if (! dumpOpen(dumpfile,pgm))
+    { pp(OUT,"Unable to open %s\n",dumpfile);
       exit(1);
     }
-    strcpy(pgm,argv[1]);
-    if (strchr (pgm, '.') == NULL)
-        strcat(pgm,".cm");// if no extension is given, append .cm (c minus) to the filename
-    source = fopen(pgm,"r");
-    //redundant_source = fopen(pgm, "r"); <- use redundant_source to print whole lines in lex output
-    redundant_source = fopen(pgm, "r"); // Open the redundant source file
-    if (source==NULL || redundant_source == NULL)
-    { fprintf(stderr,"File %s not found\n",pgm);
-        exit(1);
-    }
-    if (source==NULL)
-    { fprintf(stderr,"File %s not found\n",pgm);
-        exit(1);
-    }
-    
-    char detailpath[200];
-    if (3 == argc) {
-        strcpy(detailpath,argv[2]);
-    } else strcpy(detailpath,"/tmp/");// default detailpath is /tmp. Check there if you called by hand.
-    //// end opening sources ////
-    
-    listing = stdout; /* send messages from main() to screen */
-    initializePrinter(detailpath, pgm, LOGALL);// init logger in /lib/log.c
-    // for the lexical analysis, you might change LOGALL to LER, to generate only lex and err outputs.
+  }
       
-  fprintf(listing,"\nTINY COMPILATION: %s\n",pgm);
-#if NO_PARSE
-  while (getToken()!=ENDFILE);
-#else
-  syntaxTree = parse();
-  doneLEXstartSYN();
-  if (TraceParse) {
-    fprintf(listing,"\nSyntax tree:\n");
-    printTree(syntaxTree);
-  }
-#if !NO_ANALYZE
-  doneSYNstartTAB();
-  if (! Error)
-  { if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table...\n");
+  pp(OUT,"\nTINY COMPILATION: %s\n",pgm);
+  if (lastPhase == RUN_LEX)
+  { phaseEnter(PHASE_LEX);
+    while (getToken()!=ENDFILE);
+    phaseLeave();
+    diagFlush();
+  }
+  else
+  { phaseEnter(PHASE_PARSE);
+    syntaxTree = parse();
+    diagFlush();
+    doneLEXstartSYN();
+    if (TRACE_ON(TraceParse)) {
+      pp(OUT,"\nSyntax tree:\n");
+      if (dumpActive())
+      { dumpTree(syntaxTree);
+        onlyStdout(TRUE); /* the text tree still goes to stdout */
+      }
+      printTree(syntaxTree);
+      onlyStdout(FALSE);
+    }
+    phaseLeave();
+  }
+  if (lastPhase >= RUN_ANALYZE)
+    doneSYNstartTAB();
+  if (lastPhase >= RUN_ANALYZE && ! Error && ! diagLimitReached())
+  { if (TRACE_ON(TraceAnalyze)) pp(OUT,"\nBuilding Symbol Table...\n");
+    setAnalysisJobs(analysisJobs);
+    phaseEnter(PHASE_SYMTAB);
     buildSymtab(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nChecking Types...\n");
-    typeCheck(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
+    phaseLeave();
+    if (TRACE_ON(TraceAnalyze)) pp(OUT,"\nChecking Types...\n");
+    phaseEnter(PHASE_TYPECHECK);
+    if (! diagLimitReached()) typeCheck(syntaxTree);
+    phaseLeave();
+    if (TRACE_ON(TraceAnalyze)) pp(OUT,"\nType Checking Finished\n");
+    if (symtabStats) st_printStats(stderr,symtabStatsJson);
+    if (callGraph)
+    { if (callGraphJson) cgPrintJson(stderr);
+      else cgPrintDot(stderr);
+    }
+    if (frameReport)
+    { phaseEnter(PHASE_CODEGEN); /* frame layout is the first step of code generation */
+      layoutFrames(syntaxTree);
+      phaseLeave();
+      printFrameReport(stderr);
+    }
   }
 #if !NO_CODE
-  if (! Error)
+  if (lastPhase >= RUN_CODEGEN && ! Error)
   { char * codefile;
     int fnlen = strcspn(pgm,".");
     codefile = (char *) calloc(fnlen+4, sizeof(char));
@@ -112,17 +356,250 @@ int main( int argc, char * argv[] )
     strcat(codefile,".tm");
     code = fopen(codefile,"w");
     if (code == NULL)
-    { printf("Unable to open %s\n",codefile);
+    { pp(OUT,"Unable to open %s\n",codefile);
       exit(1);
     }
+    phaseEnter(PHASE_CODEGEN);
+    layoutFrames(syntaxTree);
     codeGen(syntaxTree,codefile);
     fclose(code);
+    phaseLeave();
   }
-#endif
-#endif
 #endif
   fclose(source);
   fclose(redundant_source); // Close the redundant source file
-  return 0;
+  phaseEnter(PHASE_OUTPUT);
+  dumpClose();
+  closePrinter();
+  phaseLeave();
+  freeTree(syntaxTree);
+  if (expectDir != NULL && expectFinish() > 0)
+    status = 1;
+  return status;
+}
+
+/* compiles one source file; returns 1 if it is missing or
+ * differs from --expect, 0 otherwise */
+static int compile(const char * file, const char * detailpath)
+{ char pgm[PATH_MAX]; /* source code file name */
+  int n, status;
+
+  //// opening sources ////
+  // if no extension is given, append .cm (c minus) to the filename
+  n = snprintf(pgm,sizeof(pgm),strchr(file,'.') == NULL ? "%s.cm" : "%s",file);
+  if (n < 0 || n >= (int) sizeof(pgm))
+  { fprintf(stderr,"File name too long: %s\n",file);
+    return 1;
+  }
+  source = fopen(pgm,"r");
+  //redundant_source = fopen(pgm, "r"); <- use redundant_source to print whole lines in lex output
+  redundant_source = fopen(pgm, "r"); // Open the redundant source file
+  if (source==NULL || redundant_source == NULL)
+  { fprintf(stderr,"File %s not found\n",pgm);
+    if (source != NULL) fclose(source);
+    if (redundant_source != NULL) fclose(redundant_source);
+    return 1;
+  }
+  //// end opening sources ////
+  if (useCache && cacheLookup(pgm,cacheOptions,stageFiles(),detailpath))
+  { fclose(source);
+    fclose(redundant_source);
+    return 0;
+  }
+  status = compileSource(pgm,detailpath);
+  cacheStore(status); /* after a miss */
+  return status;
+}
+
+/* options that leave the outputs as they are: not in the key
+ * of the cache */
+static int keepsOutputs(const char * arg)
+{ static const char * options[] =
+  { "--cache", "--jobs=", "--async-log", "--time-report", "--mem-report", "--trace-events=", NULL };
+  int i;
+  for (i = 0; options[i] != NULL; i++)
+    if (strncmp(arg,options[i],strlen(options[i])) == 0) return TRUE;
+  return FALSE;
+}
+
+/* WatchHandler */
+static int compileWatched(const char * file)
+{ return compile(file,watchDetailDir);
 }
 
+/* the options a --serve request may give; the others are
+ * fixed when the server starts. Each request starts from the
+ * options of the server */
+static const char * requestOptions[] =
+{ "--lex-only", "-fsyntax-only", "--no-codegen", "--trace=", "--log=", "--max-errors=",
+  "--jobs=", "--diag-format=", "--symtab-stats", "--frame-report", "--callgraph", NULL };
+
+typedef struct
+{ LastPhase lastPhase;
+  FileDestination logFiles;
+  int echoSource, traceScan, traceParse, traceAnalyze, traceCode;
+  int maxErrors, analysisJobs;
+  DiagFormat diagFormat;
+  int symtabStats, symtabStatsJson, frameReport, callGraph, callGraphJson;
+} RequestOptions;
+
+static RequestOptions serverOptions;
+
+static void saveOptions(RequestOptions * o)
+{ o->lastPhase = lastPhase;
+  o->logFiles = logFiles;
+  o->echoSource = EchoSource;
+  o->traceScan = TraceScan;
+  o->traceParse = TraceParse;
+  o->traceAnalyze = TraceAnalyze;
+  o->traceCode = TraceCode;
+  o->maxErrors = maxErrors;
+  o->analysisJobs = analysisJobs;
+  o->diagFormat = diagFormat;
+  o->symtabStats = symtabStats;
+  o->symtabStatsJson = symtabStatsJson;
+  o->frameReport = frameReport;
+  o->callGraph = callGraph;
+  o->callGraphJson = callGraphJson;
+}
+
+static void restoreOptions(const RequestOptions * o)
+{ lastPhase = o->lastPhase;
+  logFiles = o->logFiles;
+  EchoSource = o->echoSource;
+  TraceScan = o->traceScan;
+  TraceParse = o->traceParse;
+  TraceAnalyze = o->traceAnalyze;
+  TraceCode = o->traceCode;
+  maxErrors = o->maxErrors;
+  analysisJobs = o->analysisJobs;
+  diagFormat = o->diagFormat;
+  symtabStats = o->symtabStats;
+  symtabStatsJson = o->symtabStatsJson;
+  frameReport = o->frameReport;
+  callGraph = o->callGraph;
+  callGraphJson = o->callGraphJson;
+}
+
+static int isRequestOption(const char * arg)
+{ int i;
+  for (i = 0; requestOptions[i] != NULL; i++)
+    if (strncmp(arg,requestOptions[i],strlen(requestOptions[i])) == 0) return TRUE;
+  return FALSE;
+}
+
+/* ServeHandler: the source comes from memory, the stages go to
+ * memory (see serve.c) */
+static int compileRequest(const ServeRequest * request, FileDestination * stages)
+{ int i;
+  restoreOptions(&serverOptions);
+  for (i = 0; i < request->nargs; i++)
+    if (! isRequestOption(request->args[i]) || ! parseOption(request->args[i]))
+    { fprintf(stderr,"option not valid in a request: %s\n",request->args[i]);
+      return 2;
+    }
+  /* fmemopen needs at least one byte */
+  if (request->len > 0)
+  { source = fmemopen((void *) request->text,request->len,"r");
+    redundant_source = fmemopen((void *) request->text,request->len,"r");
+  }
+  else
+  { source = fopen("/dev/null","r");
+    redundant_source = fopen("/dev/null","r");
+  }
+  if (source == NULL || redundant_source == NULL)
+  { perror("fmemopen");
+    if (source != NULL) fclose(source);
+    if (redundant_source != NULL) fclose(redundant_source);
+    return 2;
+  }
+  *stages = stageFiles();
+  return compileSource(request->name,"/tmp");
+}
+
+int main( int argc, char * argv[] )
+{ char ** args; /* positional arguments: filenames (and detailpath without -d) */
+  char * detailDir = NULL; /* -d <detaildir> */
+  char * serveSocket = NULL; /* --serve <socket> */
+  char * watchDir = NULL; /* --watch <dir> */
+  int nargs = 0;
+  int status = 0;
+  int i;
+
+    args = (char **) malloc(argc * sizeof(char *));
+
+    //// parsing options ////
+    for (i = 1; i < argc; i++)
+    { if (strcmp(argv[i],"-d") == 0 && i + 1 < argc)
+        detailDir = argv[++i];
+      else if (strcmp(argv[i],"--serve") == 0 && i + 1 < argc)
+        serveSocket = argv[++i];
+      else if (strcmp(argv[i],"--watch") == 0 && i + 1 < argc)
+        watchDir = argv[++i];
+      else if (argv[i][0] != '-')
+        args[nargs++] = argv[i];
+      else if (! parseOption(argv[i]))
+      { fprintf(stderr,"unknown or invalid option: %s\n",argv[i]);
+        usage(argv[0]);
+      }
+      else if (! keepsOutputs(argv[i]))
+      { size_t len = cacheOptions ? strlen(cacheOptions) : 0;
+        cacheOptions = (char *) realloc(cacheOptions,len + strlen(argv[i]) + 2);
+        sprintf(cacheOptions + len,"%s\n",argv[i]);
+      }
+    }
+    if (cacheOptions == NULL) cacheOptions = copyString("");
+  
+    if (timeReport) phaseTiming(TRUE);
+    if (memReport) memTracking(TRUE);
+    if (traceEventsFile != NULL && ! phaseTraceOpen(traceEventsFile))
+    { fprintf(stderr,"Unable to open %s\n",traceEventsFile);
+      exit(1);
+    }
+
+    if (serveSocket != NULL)
+    { if (nargs > 0 || detailDir != NULL || expectDir != NULL || binaryDump)
+        usage(argv[0]); /* the sources and the listings are the requests' */
+    }
+    else if (watchDir != NULL)
+    { if (nargs > 0 || binaryDump)
+        usage(argv[0]); /* the sources are those of the directory */
+    }
+    else if (nargs < 1)
+      usage(argv[0]);
+    if (detailDir == NULL && nargs > 2)
+      usage(argv[0]);
+    if (expectDir != NULL && binaryDump)
+      usage(argv[0]); /* the dump takes the listings */
+    listing = stdout; /* send messages from main() to screen */
+    /* the reports on stderr and the comparisons need a compilation */
+    if (cacheDirectory != NULL && serveSocket == NULL && watchDir == NULL && expectDir == NULL &&
+        ! binaryDump && ! symtabStats && ! frameReport && ! callGraph)
+      useCache = cacheOpen(cacheDirectory,cacheSize);
+
+    if (serveSocket != NULL && watchDir != NULL)
+      usage(argv[0]);
+    if (serveSocket != NULL)
+    { saveOptions(&serverOptions);
+      routeStage(ER_ | LEX | SYN | TAB | GEN, ROUTE_MEMORY);
+      if (! serve(serveSocket,compileRequest)) status = 1;
+    }
+    else if (watchDir != NULL)
+    { watchDetailDir = detailDir != NULL ? detailDir : "/tmp/";
+      mirrorStdout(FALSE); /* one line per compilation instead */
+      if (! watch(watchDir,compileWatched)) status = 1;
+    }
+    else if (detailDir != NULL)
+    { for (i = 0; i < nargs; i++)
+        if (compile(args[i],detailDir) != 0) status = 1;
+    }
+    else if (nargs == 2)
+      status = compile(args[0],args[1]);
+    else status = compile(args[0],"/tmp/");// default detailpath is /tmp. Check there if you called by hand.
+
+  phaseTraceClose();
+  if (timeReport) phasePrintReport(stderr,timeReportJson);
+  if (memReport) memPrintReport(stderr,memReportJson);
+  if (cacheStats) cachePrintStats(stderr);
+  return status;
+}
@@ -0,0 +1,196 @@
+/****************************************************/
+/* File: memtrack.c                                 */
+/* Allocation accounting per compiler phase         */
+/****************************************************/
+
+#define MEMTRACK_IMPL
+#include <malloc.h>
+#include <sys/resource.h>
+#include "memtrack.h"
+#include "phase.h"
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+typedef struct
+{ long allocs;        /* malloc, calloc and growing reallocs */
+  long frees;
+  size_t bytes;       /* allocated */
+  size_t freed;
+  size_t peak;        /* live bytes of the process, highest seen in the phase */
+} MemStats;
+
+/* updated by the analysis threads too: atomics */
+static MemStats stats[PHASE_COUNT];
+static size_t live = 0, peakLive = 0;
+static int tracking = FALSE;
+
+/* the blocks charged, by address, with the size charged: free
+ * also gets blocks of the C library (getline, scandir) and blocks
+ * allocated before tracking started, which were never charged.
+ * Chained hash of BLOCK_BUCKETS lists, BLOCK_LOCKS spin locks */
+#define BLOCK_BITS 16
+#define BLOCK_BUCKETS (1 << BLOCK_BITS)
+#define BLOCK_LOCKS 64
+
+typedef struct block
+{ void * p;
+  size_t size;
+  struct block * next;
+} Block;
+
+static Block ** blocks = NULL;
+static unsigned char locks[BLOCK_LOCKS];
+
+static size_t bucketOf(void * p)
+{ return (size_t) ((((unsigned long long) (size_t) p >> 4) * 0x9E3779B97F4A7C15ULL)
+                   >> (64 - BLOCK_BITS));
+}
+
+static void lock(size_t b)
+{ while (__atomic_test_and_set(&locks[b % BLOCK_LOCKS], __ATOMIC_ACQUIRE))
+    ;
+}
+
+static void unlock(size_t b)
+{ __atomic_clear(&locks[b % BLOCK_LOCKS], __ATOMIC_RELEASE);
+}
+
+/* records p with size; returns the size of an older record of
+ * the same address (its block was freed without the wrappers) */
+static size_t remember(void * p, size_t size)
+{ size_t b = bucketOf(p), old = 0;
+  Block * k;
+  lock(b);
+  for (k = blocks[b]; k != NULL && k->p != p; k = k->next)
+    ;
+  if (k != NULL) old = k->size;
+  else if ((k = (Block *) malloc(sizeof(Block))) != NULL)
+  { k->p = p;
+    k->next = blocks[b];
+    blocks[b] = k;
+  }
+  if (k != NULL) k->size = size;
+  unlock(b);
+  return old;
+}
+
+/* removes p; FALSE if it was never charged */
+static int forget(void * p, size_t * size)
+{ size_t b = bucketOf(p);
+  Block ** k;
+  int found = FALSE;
+  lock(b);
+  for (k = &blocks[b]; *k != NULL && (*k)->p != p; k = &(*k)->next)
+    ;
+  if (*k != NULL)
+  { Block * dead = *k;
+    *size = dead->size;
+    *k = dead->next;
+    free(dead);
+    found = TRUE;
+  }
+  unlock(b);
+  return found;
+}
+
+static void add(size_t * counter, size_t n)
+{ __atomic_add_fetch(counter, n, __ATOMIC_RELAXED);
+}
+
+static void raisePeak(size_t * peak, size_t value)
+{ size_t old = __atomic_load_n(peak, __ATOMIC_RELAXED);
+  while (value > old &&
+         !__atomic_compare_exchange_n(peak, &old, value, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+static void charge(void * p)
+{ MemStats * s = &stats[phaseCurrent()];
+  size_t n = malloc_usable_size(p);
+  size_t old = remember(p, n);
+  size_t now = __atomic_add_fetch(&live, n - old, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&s->allocs, 1, __ATOMIC_RELAXED);
+  add(&s->bytes, n);
+  raisePeak(&s->peak, now);
+  raisePeak(&peakLive, now);
+}
+
+/* FALSE, and nothing counted, if p was not charged */
+static int discharge(void * p)
+{ MemStats * s = &stats[phaseCurrent()];
+  size_t n;
+  if (!forget(p, &n)) return FALSE;
+  __atomic_sub_fetch(&live, n, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&s->frees, 1, __ATOMIC_RELAXED);
+  add(&s->freed, n);
+  return TRUE;
+}
+
+void * memMalloc(size_t size)
+{ void * p = malloc(size);
+  if (tracking && p != NULL) charge(p);
+  return p;
+}
+
+void * memCalloc(size_t count, size_t size)
+{ void * p = calloc(count, size);
+  if (tracking && p != NULL) charge(p);
+  return p;
+}
+
+void * memRealloc(void * p, size_t size)
+{ void * q;
+  int charged;
+  if (!tracking) return realloc(p, size);
+  /* accounted as a free of the old block and a new block */
+  charged = p != NULL && discharge(p);
+  q = realloc(p, size);
+  if (q != NULL) charge(q);
+  else if (charged && size > 0) charge(p); /* failed: p is still there */
+  return q;
+}
+
+void memFree(void * p)
+{ if (tracking && p != NULL) discharge(p);
+  free(p);
+}
+
+void memTracking(int on)
+{ if (on && blocks == NULL)
+  { blocks = (Block **) calloc(BLOCK_BUCKETS, sizeof(Block *));
+    if (blocks == NULL) return;
+  }
+  tracking = on;
+}
+
+void memPrintReport(FILE * out, int json)
+{ struct rusage usage;
+  long maxRss = 0;
+  int i;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    maxRss = usage.ru_maxrss; /* KiB on Linux */
+  if (json)
+  { fprintf(out,"{\"phases\": [");
+    for (i = 0; i < PHASE_COUNT; i++)
+      fprintf(out,"%s\n  {\"phase\": \"%s\", \"allocs\": %ld, \"frees\": %ld, "
+                  "\"bytes\": %zu, \"freed_bytes\": %zu, \"peak_live_bytes\": %zu}",
+              i ? "," : "", phaseName((Phase) i), stats[i].allocs, stats[i].frees,
+              stats[i].bytes, stats[i].freed, stats[i].peak);
+    fprintf(out,"\n],\n \"live_bytes\": %zu, \"peak_live_bytes\": %zu, \"peak_rss_kib\": %ld}\n",
+            live, peakLive, maxRss);
+    return;
+  }
+  fprintf(out,"phase          allocs      frees          bytes    freed bytes  peak live bytes\n");
+  fprintf(out,"----------  ---------  ---------  -------------  -------------  ---------------\n");
+  for (i = 0; i < PHASE_COUNT; i++)
+    fprintf(out,"%-10s  %9ld  %9ld  %13zu  %13zu  %15zu\n", phaseName((Phase) i),
+            stats[i].allocs, stats[i].frees, stats[i].bytes, stats[i].freed, stats[i].peak);
+  fprintf(out,"----------  ---------  ---------  -------------  -------------  ---------------\n");
+  fprintf(out,"live at exit: %zu bytes, peak live: %zu bytes, peak RSS: %ld KiB\n",
+          live, peakLive, maxRss);
+}
@@ -0,0 +1,39 @@
+/****************************************************/
+/* File: memtrack.h                                 */
+/* Allocation accounting per compiler phase         */
+/* (mycmcomp --mem-report)                          */
+/****************************************************/
+
+#ifndef _MEMTRACK_H_
+#define _MEMTRACK_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Every file that includes globals.h (or this header) allocates
+ * through these wrappers. While tracking is on they charge the
+ * allocation count and bytes to the current phase (phase.h) and
+ * keep the live and peak live bytes; otherwise they only call
+ * the C library. Sizes are the usable sizes of the blocks. Only
+ * the blocks charged are discharged when freed: the blocks of
+ * the C library (getline, scandir, strdup) and those allocated
+ * before tracking are left out of the counts.
+ */
+void * memMalloc(size_t size);
+void * memCalloc(size_t count, size_t size);
+void * memRealloc(void * p, size_t size);
+void memFree(void * p);
+
+void memTracking(int on);
+
+/* per phase counts, live bytes, and the peak RSS of the process */
+void memPrintReport(FILE * out, int json);
+
+#ifndef MEMTRACK_IMPL
+#define malloc(size) memMalloc(size)
+#define calloc(count, size) memCalloc(count, size)
+#define realloc(p, size) memRealloc(p, size)
+#define free(p) memFree(p)
+#endif
+
+#endif
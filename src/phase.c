@@ -0,0 +1,203 @@
+/****************************************************/
+/* File: phase.c                                    */
+/* Phases of the compiler: timing and output bytes  */
+/****************************************************/
+
+#include <time.h>
+#include <pthread.h>
+#include "globals.h"
+#include "phase.h"
+
+#define MAX_DEPTH 16
+
+typedef struct
+{ double wall;        /* seconds */
+  double cpu;         /* seconds, of all the threads */
+  size_t bytes;       /* output bytes (see outputBytes in log.h) */
+} PhaseStats;
+
+static const char * names[PHASE_COUNT] =
+{ "driver", "lex", "parse", "symtab", "typecheck", "codegen", "output" };
+
+static PhaseStats stats[PHASE_COUNT];
+static Phase stack[MAX_DEPTH] = { PHASE_NONE };
+static int depth = 0;
+static int overflow = 0;  /* phaseEnter calls past MAX_DEPTH */
+static int timing = FALSE;
+
+/* start of the slice of the current phase */
+static double sliceWall, sliceCpu;
+static size_t sliceBytes;
+
+/* --trace-events */
+static FILE * trace = NULL;
+static double traceStart;
+static int traceEvents = 0;
+static int traceThreads = 0;
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local int traceTid = 0;
+static double phaseStart[MAX_DEPTH];
+
+static double seconds(clockid_t clock)
+{ struct timespec t;
+  clock_gettime(clock, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* charges the time and bytes since the last switch to the
+ * current phase, and starts a new slice */
+static void switchSlice(void)
+{ double wall = seconds(CLOCK_MONOTONIC);
+  double cpu = seconds(CLOCK_PROCESS_CPUTIME_ID);
+  size_t bytes = outputBytes();
+  PhaseStats * s = &stats[stack[depth]];
+  s->wall += wall - sliceWall;
+  s->cpu += cpu - sliceCpu;
+  s->bytes += bytes - sliceBytes;
+  sliceWall = wall;
+  sliceCpu = cpu;
+  sliceBytes = bytes;
+}
+
+void phaseTiming(int on)
+{ if (on && !timing)
+  { sliceWall = seconds(CLOCK_MONOTONIC);
+    sliceCpu = seconds(CLOCK_PROCESS_CPUTIME_ID);
+    sliceBytes = outputBytes();
+  }
+  timing = on;
+}
+
+/* prints the separator of the next event; needs traceLock */
+static void nextEvent(void)
+{ fprintf(trace,"%s\n", traceEvents++ ? "," : "");
+}
+
+/* id of the calling thread in the trace: the first thread that
+ * asks is the driver, the others are the analysis threads */
+static int threadId(void)
+{ if (traceTid == 0)
+  { traceTid = ++traceThreads;
+    nextEvent();
+    if (traceTid == 1)
+      fprintf(trace,"{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, "
+                    "\"args\": {\"name\": \"driver\"}}");
+    else
+      fprintf(trace,"{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                    "\"args\": {\"name\": \"worker %d\"}}", traceTid, traceTid - 1);
+  }
+  return traceTid;
+}
+
+/* a complete event from start to now, times in seconds */
+static void writeSpan(const char * name, Phase phase, const char * function,
+                      int nodes, double start)
+{ double now = seconds(CLOCK_MONOTONIC);
+  pthread_mutex_lock(&traceLock);
+  if (trace != NULL)
+  { int tid = threadId();
+    nextEvent();
+    fprintf(trace,"{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                  "\"ts\": %.3f, \"dur\": %.3f",
+            name, function ? "function" : "phase", tid,
+            (start - traceStart) * 1e6, (now - start) * 1e6);
+    if (function != NULL)
+      fprintf(trace,", \"args\": {\"phase\": \"%s\", \"nodes\": %d}", phaseName(phase), nodes);
+    fprintf(trace,"}");
+  }
+  pthread_mutex_unlock(&traceLock);
+}
+
+void phaseEnter(Phase phase)
+{ if (depth + 1 >= MAX_DEPTH)
+  { overflow++;
+    return;
+  }
+  if (timing) switchSlice();
+  stack[++depth] = phase;
+  if (trace != NULL) phaseStart[depth] = seconds(CLOCK_MONOTONIC);
+}
+
+void phaseLeave(void)
+{ if (overflow > 0)
+  { overflow--;
+    return;
+  }
+  if (depth == 0) return;
+  if (timing) switchSlice();
+  /* only the phases of the driver: the scanner, entered for
+   * each token, would flood the trace */
+  if (trace != NULL && depth == 1)
+    writeSpan(phaseName(stack[depth]), stack[depth], NULL, 0, phaseStart[depth]);
+  depth--;
+}
+
+Phase phaseCurrent(void)
+{ return stack[depth];
+}
+
+const char * phaseName(Phase phase)
+{ return (phase >= 0 && phase < PHASE_COUNT) ? names[phase] : "?";
+}
+
+void phasePrintReport(FILE * out, int json)
+{ PhaseStats total = { 0.0, 0.0, 0 };
+  int i;
+  if (timing) switchSlice();
+  for (i = 0; i < PHASE_COUNT; i++)
+  { total.wall += stats[i].wall;
+    total.cpu += stats[i].cpu;
+    total.bytes += stats[i].bytes;
+  }
+  if (json)
+  { fprintf(out,"{\"phases\": [");
+    for (i = 0; i < PHASE_COUNT; i++)
+      fprintf(out,"%s\n  {\"phase\": \"%s\", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, "
+                  "\"output_bytes\": %zu}",
+              i ? "," : "", names[i], stats[i].wall * 1e3, stats[i].cpu * 1e3, stats[i].bytes);
+    fprintf(out,"\n],\n \"total\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"output_bytes\": %zu}}\n",
+            total.wall * 1e3, total.cpu * 1e3, total.bytes);
+    return;
+  }
+  fprintf(out,"phase         wall ms     cpu ms   wall %%   output bytes\n");
+  fprintf(out,"----------  ---------  ---------  -------  -------------\n");
+  for (i = 0; i < PHASE_COUNT; i++)
+    fprintf(out,"%-10s  %9.3f  %9.3f  %6.1f%%  %13zu\n", names[i],
+            stats[i].wall * 1e3, stats[i].cpu * 1e3,
+            total.wall > 0 ? 100.0 * stats[i].wall / total.wall : 0.0, stats[i].bytes);
+  fprintf(out,"----------  ---------  ---------  -------  -------------\n");
+  fprintf(out,"%-10s  %9.3f  %9.3f  %6.1f%%  %13zu\n", "total",
+          total.wall * 1e3, total.cpu * 1e3, 100.0, total.bytes);
+}
+
+int phaseTraceOpen(const char * file)
+{ trace = fopen(file,"w");
+  if (trace == NULL) return FALSE;
+  traceStart = seconds(CLOCK_MONOTONIC);
+  fprintf(trace,"{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  pthread_mutex_lock(&traceLock);
+  threadId();
+  pthread_mutex_unlock(&traceLock);
+  return TRUE;
+}
+
+void phaseTraceClose(void)
+{ if (trace == NULL) return;
+  pthread_mutex_lock(&traceLock);
+  fprintf(trace,"\n]}\n");
+  fclose(trace);
+  trace = NULL;
+  pthread_mutex_unlock(&traceLock);
+}
+
+int phaseTracing(void)
+{ return trace != NULL;
+}
+
+double phaseSpanStart(void)
+{ return seconds(CLOCK_MONOTONIC);
+}
+
+void phaseSpan(const char * function, int nodes, double start)
+{ writeSpan(function, phaseCurrent(), function, nodes, start);
+}
@@ -0,0 +1,53 @@
+/****************************************************/
+/* File: phase.h                                    */
+/* Phases of the compiler, for the reports of the   */
+/* driver (--time-report)                           */
+/****************************************************/
+
+#ifndef _PHASE_H_
+#define _PHASE_H_
+
+#include <stdio.h>
+
+typedef enum
+{ PHASE_NONE,      /* driver code outside every phase */
+  PHASE_LEX,
+  PHASE_PARSE,
+  PHASE_SYMTAB,
+  PHASE_TYPECHECK,
+  PHASE_CODEGEN,
+  PHASE_OUTPUT,    /* flushing and closing the output files */
+  PHASE_COUNT
+} Phase;
+
+/* Phases nest: phaseEnter suspends the current phase until the
+ * matching phaseLeave, so the scanner, entered from the parser,
+ * is accounted apart. Only the main thread changes phases.
+ * Nothing is measured until phaseTiming(TRUE).
+ */
+void phaseTiming(int on);
+void phaseEnter(Phase phase);
+void phaseLeave(void);
+
+/* the phase running now */
+Phase phaseCurrent(void);
+const char * phaseName(Phase phase);
+
+/* wall and CPU time and output bytes of each phase */
+void phasePrintReport(FILE * out, int json);
+
+/* Chrome trace events (--trace-events=<file>, for Perfetto or
+ * chrome://tracing): one span for each phase the driver enters
+ * and, inside it, the spans of phaseSpan. phaseTraceOpen returns
+ * FALSE if the file cannot be written.
+ */
+int phaseTraceOpen(const char * file);
+void phaseTraceClose(void);
+int phaseTracing(void);
+
+/* a span of one function, from start (phaseSpanStart) to now,
+ * in the current phase; any thread may call them */
+double phaseSpanStart(void);
+void phaseSpan(const char * function, int nodes, double start);
+
+#endif
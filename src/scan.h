@@ -16,10 +16,16 @@ extern char tokenString[MAXTOKENLEN+1];
 
 extern int numValue;
 extern char *popId();
+extern char *peekId();
 
 /* function getToken returns the 
  * next token in source file
  */
 TokenType getToken(void);
 
+/* function resetScanner makes the next getToken
+ * start over on source, from line 1
+ */
+void resetScanner(void);
+
 #endif
@@ -1,100 +1,261 @@
 #include "scopetree.h"
+#include "log.h"
 #include <stdlib.h>
+#include <stddef.h>
+#include "memtrack.h"
+
+/* Scopes, nodes, lists and children arrays are bump-allocated from an
+ * arena of large blocks: they are never freed one by one, only all at
+ * once by freeScopeArena(). */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+typedef struct arenaBlock
+{
+  struct arenaBlock *next;
+  size_t used, size;
+  max_align_t data[];
+} ArenaBlock;
+
+static ArenaBlock *arena = NULL;
+
+static void *arenaAlloc(size_t n) {
+  n = (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  if (arena == NULL || arena->used + n > arena->size) {
+    size_t size = n > ARENA_BLOCK_SIZE ? n : ARENA_BLOCK_SIZE;
+    ArenaBlock *b = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+    if (b == NULL) {
+      fprintf(stderr, "out of memory allocating scopes\n");
+      abort();
+    }
+    b->next = arena;
+    b->used = 0;
+    b->size = size;
+    arena = b;
+  }
+  void *p = (char *)arena->data + arena->used;
+  arena->used += n;
+  return p;
+}
+
+void freeScopeArena(void) {
+  while (arena != NULL) {
+    ArenaBlock *next = arena->next;
+    free(arena);
+    arena = next;
+  }
+}
+
+/* Per tree bookkeeping, shared by all of its nodes */
+typedef struct scopeTreeInfo
+{
+  ScopeNode *root;
+  int version;  /* bumped at each insertion */
+  int numbered; /* version of the last numbering */
+  ScopeNode **byId; /* first node of each id >= 0 */
+  int byIdCap;
+  ScopeNode *negIds; /* nodes with id < 0 (e.g. the root) */
+} ScopeTreeInfo;
+
+static ScopeTreeInfo *treeOf(ScopeNode *node);
+
+static void registerId(ScopeTreeInfo *tree, ScopeNode *node) {
+  int id = node->scope->id;
+  ScopeNode **head;
+  if (id < 0) {
+    head = &tree->negIds;
+  } else {
+    if (id >= tree->byIdCap) {
+      int cap = tree->byIdCap ? tree->byIdCap : 16;
+      while (cap <= id)
+        cap *= 2;
+      ScopeNode **byId = (ScopeNode **)arenaAlloc(cap * sizeof(ScopeNode *));
+      memset(byId, 0, cap * sizeof(ScopeNode *));
+      if (tree->byIdCap)
+        memcpy(byId, tree->byId, tree->byIdCap * sizeof(ScopeNode *));
+      tree->byId = byId;
+      tree->byIdCap = cap;
+    }
+    head = &tree->byId[id];
+  }
+  node->nextSameId = *head;
+  *head = node;
+}
+
+static ScopeTreeInfo *treeOf(ScopeNode *node) {
+  if (node->tree == NULL) {
+    ScopeTreeInfo *tree = (ScopeTreeInfo *)arenaAlloc(sizeof(ScopeTreeInfo));
+    memset(tree, 0, sizeof(*tree));
+    tree->root = node;
+    tree->numbered = -1;
+    node->tree = tree;
+    registerId(tree, node);
+  }
+  return node->tree;
+}
 
 Scope *newScope(char *name, int id) {
-  Scope *s = (Scope *)malloc(sizeof(Scope));
+  Scope *s = (Scope *)arenaAlloc(sizeof(Scope));
   s->name = name;
   s->id = id;
   return s;
 }
 
 ScopeList newScopeList(char *name, int id) {
-  ScopeList list = (ScopeList)malloc(sizeof(struct scopeList));
+  ScopeList list = (ScopeList)arenaAlloc(sizeof(struct scopeList));
   list->scope = newScope(name, id);
   list->next = NULL;
   return list;
 }
 
 ScopeList pushScopeList(ScopeList list, char *name, int id) {
-  ScopeList newNode = (ScopeList)malloc(sizeof(struct scopeList));
-  newNode->scope = newScope(name, id);
-  newNode->next = NULL;
-  ScopeList p = list;
-  while (p->next != NULL)
-    p = p->next;
-  p->next = newNode;
-  return list;
-}
-
-ScopeNode *newRootScopeNode() {
-  ScopeNode *newNode = (ScopeNode *)malloc(sizeof(ScopeNode));
-  newNode->scope = newScope("", -1);
-  newNode->children = NULL;
-  newNode->parent = NULL;
-  newNode->numChildren = 0;
+  ScopeList newNode = newScopeList(name, id);
+  newNode->next = list;
   return newNode;
 }
 
 ScopeNode *newScopeNode(char *name, int id) {
-  ScopeNode *newNode = (ScopeNode *)malloc(sizeof(ScopeNode));
+  ScopeNode *newNode = (ScopeNode *)arenaAlloc(sizeof(ScopeNode));
   newNode->scope = newScope(name, id);
   newNode->children = NULL;
   newNode->parent = NULL;
   newNode->numChildren = 0;
+  newNode->capChildren = 0;
+  newNode->pre = newNode->post = -1;
+  newNode->nextSameId = NULL;
+  newNode->tree = NULL;
   return newNode;
 }
 
+ScopeNode *newRootScopeNode() {
+  ScopeNode *root = newScopeNode("", -1);
+  treeOf(root);
+  return root;
+}
+
 ScopeNode *insertScope(ScopeNode *currNode, char *name, int prevId) {
+  ScopeTreeInfo *tree = treeOf(currNode);
   ScopeNode *newNode = newScopeNode(name, prevId + 1);
-  if (currNode->children == NULL) {
-    currNode->children = (ScopeNode **)malloc(sizeof(ScopeNode *));
-    currNode->children[0] = newNode;
-    currNode->children[0]->parent = currNode;
-    ++(currNode->numChildren);
-  } else {
-    currNode->children =
-        (ScopeNode **)realloc(currNode->children, (++(currNode->numChildren))*sizeof(ScopeNode*));
-    currNode->children[currNode->numChildren - 1] = newNode;
-    currNode->children[currNode->numChildren - 1]->parent = currNode;
+
+  if (currNode->numChildren == currNode->capChildren) {
+    int cap = currNode->capChildren ? 2 * currNode->capChildren : 4;
+    ScopeNode **children = (ScopeNode **)arenaAlloc(cap * sizeof(ScopeNode *));
+    if (currNode->numChildren)
+      memcpy(children, currNode->children,
+             currNode->numChildren * sizeof(ScopeNode *));
+    currNode->children = children;
+    currNode->capChildren = cap;
   }
-  return currNode->children[currNode->numChildren - 1];
+  currNode->children[currNode->numChildren++] = newNode;
+  newNode->parent = currNode;
+  newNode->tree = tree;
+  registerId(tree, newNode);
+  tree->version++;
+  return newNode;
 }
 
-bool isInsideScope(ScopeNode *node, ScopeList scopes) {
-  while (node != NULL) // maybe node->parent ?
-  {
-    for (ScopeList s = scopes; s != NULL; s = s->next) {
-      if (node->scope->id == s->scope->id) {
-        return true;
+void numberScopeTree(ScopeNode *root) {
+  ScopeTreeInfo *tree = treeOf(root);
+  int counter = 0;
+  int depth = 0, cap = 64;
+  /* explicit stack (node, next child) so deep trees do not recurse */
+  ScopeNode **nodes = (ScopeNode **)malloc(cap * sizeof(ScopeNode *));
+  int *next = (int *)malloc(cap * sizeof(int));
+
+  root = tree->root;
+  root->pre = counter++;
+  nodes[0] = root;
+  next[0] = 0;
+  while (depth >= 0) {
+    ScopeNode *node = nodes[depth];
+    if (next[depth] < node->numChildren) {
+      ScopeNode *child = node->children[next[depth]++];
+      if (++depth == cap) {
+        cap *= 2;
+        nodes = (ScopeNode **)realloc(nodes, cap * sizeof(ScopeNode *));
+        next = (int *)realloc(next, cap * sizeof(int));
       }
+      child->pre = counter++;
+      nodes[depth] = child;
+      next[depth] = 0;
+    } else {
+      node->post = counter++;
+      --depth;
     }
-    node = node->parent;
   }
-  return false;
+  free(nodes);
+  free(next);
+  tree->numbered = tree->version;
 }
 
-void printScopeTreeNode(char *prefix, ScopeNode *node, bool isLast) {
-  if (node == NULL) {
-    return;
+static void ensureNumbered(ScopeTreeInfo *tree) {
+  if (tree->numbered != tree->version)
+    numberScopeTree(tree->root);
+}
+
+bool isInsideScopeNode(ScopeNode *node, ScopeNode *scope) {
+  if (node == NULL || scope == NULL)
+    return false;
+  if (node == scope)
+    return true;
+  if (node->tree == NULL || node->tree != scope->tree)
+    return false;
+  ensureNumbered(node->tree);
+  return scope->pre <= node->pre && node->post <= scope->post;
+}
+
+bool isInsideScope(ScopeNode *node, ScopeList scopes) {
+  if (node == NULL)
+    return false;
+  ScopeTreeInfo *tree = treeOf(node);
+  for (ScopeList s = scopes; s != NULL; s = s->next) {
+    int id = s->scope->id;
+    ScopeNode *candidate;
+    if (id < 0)
+      candidate = tree->negIds;
+    else
+      candidate = id < tree->byIdCap ? tree->byId[id] : NULL;
+    for (; candidate != NULL; candidate = candidate->nextSameId) {
+      if (isInsideScopeNode(node, candidate))
+        return true;
+    }
   }
+  return false;
+}
 
-  printf("%s%s%s#%d\n", prefix, isLast ? "└──" : "├──", node->scope->name,
-         node->scope->id);
+/* prints node and its subtree; prefix is a shared buffer of capacity
+ * *cap holding len bytes, grown as the tree gets deeper */
+static void printScopeTreeRec(char **prefix, size_t len, size_t *cap,
+                              ScopeNode *node, bool isLast) {
+  pp(OUT, "%.*s%s%s#%d\n", (int)len, *prefix, isLast ? "└──" : "├──",
+         node->scope->name, node->scope->id);
 
-  char *newprefix = (char *)malloc(1024 * sizeof(char));
-  newprefix = strcpy(newprefix, prefix);
-  newprefix = strcat(newprefix, isLast ? "    " : "│   ");
+  const char *more = isLast ? "    " : "│   ";
+  size_t n = strlen(more);
+  if (len + n > *cap) {
+    *cap = 2 * (len + n);
+    *prefix = (char *)realloc(*prefix, *cap);
+  }
+  memcpy(*prefix + len, more, n);
   for (int child = 0; child < node->numChildren; ++child) {
-    printScopeTreeNode(newprefix, node->children[child],
-                       child + 1 == node->numChildren);
+    printScopeTreeRec(prefix, len + n, cap, node->children[child],
+                      child + 1 == node->numChildren);
   }
+}
 
-  free(newprefix);
+void printScopeTreeNode(char *prefix, ScopeNode *node, bool isLast) {
+  if (node == NULL) {
+    return;
+  }
+  size_t len = strlen(prefix);
+  size_t cap = len + 256;
+  char *buf = (char *)malloc(cap);
+  memcpy(buf, prefix, len);
+  printScopeTreeRec(&buf, len, &cap, node, isLast);
+  free(buf);
 }
 
 void printScopeTree(ScopeNode *root) {
-  printf("\nScope Tree:\n\n");
-  char *prefix = (char *)malloc(1024 * sizeof(char));
-  printScopeTreeNode(prefix, root, true);
-  free(prefix);
-}
\ No newline at end of file
+  pp(OUT, "\nScope Tree:\n\n");
+  printScopeTreeNode("", root, true);
+}
@@ -21,14 +21,21 @@ typedef struct scopeList
 
 ScopeList newScopeList(char *name, int id);
 
+/* pushes in O(1) at the head: use the returned list */
 ScopeList pushScopeList(ScopeList list, char *name, int id);
 
+struct scopeTreeInfo;
+
 typedef struct scopeNode
 {
   Scope *scope;
   struct scopeNode *parent;
   struct scopeNode **children;
   int numChildren;
+  int capChildren; /* children grows geometrically */
+  int pre, post;   /* Euler-tour interval, valid after numberScopeTree() */
+  struct scopeNode *nextSameId;  /* other nodes of the tree with the same id */
+  struct scopeTreeInfo *tree;    /* tree this node belongs to */
 } ScopeNode;
 
 ScopeNode *newRootScopeNode();
@@ -37,10 +44,21 @@ ScopeNode *newScopeNode(char *name, int id);
 
 ScopeNode *insertScope(ScopeNode *currNode, char *name, int prevId);
 
+/* numbers the tree of root with pre/post intervals (Euler tour).
+ * Called lazily by the queries after insertions. */
+void numberScopeTree(ScopeNode *root);
+
+/* true if node is scope or is nested inside it: O(1) */
+bool isInsideScopeNode(ScopeNode *node, ScopeNode *scope);
+
+/* true if node is nested inside any scope (by id) of the list */
 bool isInsideScope(ScopeNode *node, ScopeList scopes);
 
 void printScopeTreeNode(char *prefix, ScopeNode *node, bool isLast);
 
 void printScopeTree(ScopeNode *root);
 
-#endif
\ No newline at end of file
+/* releases every scope, node and list allocated so far */
+void freeScopeArena(void);
+
+#endif
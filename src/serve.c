@@ -0,0 +1,221 @@
+/****************************************************/
+/* File: serve.c                                    */
+/* Compile server over a Unix domain socket         */
+/****************************************************/
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "globals.h"
+#include "util.h"
+#include "serve.h"
+
+/* longest source accepted */
+#define MAX_SOURCE (64 * 1024 * 1024)
+
+static const struct { FileDestination stage; const char * name; } stageNames[] =
+{ { ER_, "err" }, { LEX, "lex" }, { SYN, "syn" }, { TAB, "tab" }, { GEN, "gen" } };
+
+/* stdout and stderr of the compilations: kept open and emptied
+ * at each request */
+static FILE * capturedOut = NULL;
+static FILE * capturedErr = NULL;
+
+/* the text of the request, reused from one request to the next */
+static char * text = NULL;
+static size_t capText = 0;
+static char * line = NULL;
+static size_t capLine = 0;
+
+/* reads a request; returns FALSE if it is malformed, and sets
+ * quit for a quit request */
+static int readRequest(FILE * in, ServeRequest * req, int * quit)
+{ ssize_t n;
+  req->nargs = 0;
+  req->name = NULL;
+  *quit = FALSE;
+  while ((n = getline(&line, &capLine, in)) > 0)
+  { char * arg;
+    if (line[n - 1] == '\n') line[--n] = '\0';
+    arg = strchr(line, ' ');
+    if (arg != NULL) *arg++ = '\0';
+    if (strcmp(line, "quit") == 0)
+    { *quit = TRUE;
+      return TRUE;
+    }
+    if (arg == NULL) return FALSE;
+    if (strcmp(line, "arg") == 0)
+    { if (req->nargs == SERVE_MAX_ARGS) return FALSE;
+      req->args[req->nargs++] = copyString(arg);
+    }
+    else if (strcmp(line, "name") == 0)
+    { if (strlen(arg) > NAME_MAX) return FALSE; /* not a file name */
+      free((char *) req->name);
+      req->name = copyString(arg);
+    }
+    else if (strcmp(line, "source") == 0)
+    { long len = atol(arg);
+      if (len < 0 || len > MAX_SOURCE || req->name == NULL) return FALSE;
+      if ((size_t) len + 1 > capText)
+      { capText = len + 1;
+        text = (char *) realloc(text, capText);
+      }
+      if (fread(text, 1, len, in) != (size_t) len) return FALSE;
+      text[len] = '\0';
+      req->text = text;
+      req->len = len;
+      return TRUE;
+    }
+    else return FALSE;
+  }
+  return FALSE;
+}
+
+static void freeRequest(ServeRequest * req)
+{ int i;
+  for (i = 0; i < req->nargs; i++)
+    free(req->args[i]);
+  free((char *) req->name);
+  req->nargs = 0;
+  req->name = NULL;
+}
+
+/* empties a capture file: fd 1 or 2 shares its offset */
+static void rewindCapture(FILE * f)
+{ fflush(f);
+  if (ftruncate(fileno(f), 0) != 0) perror("ftruncate");
+  lseek(fileno(f), 0, SEEK_SET);
+}
+
+/* sends "<key> <length>\n" and the captured text */
+static void sendCapture(FILE * out, const char * key, FILE * f)
+{ char buf[8192];
+  off_t len = lseek(fileno(f), 0, SEEK_END);
+  ssize_t n;
+  fprintf(out, "%s %ld\n", key, (long) len);
+  lseek(fileno(f), 0, SEEK_SET);
+  while (len > 0 && (n = read(fileno(f), buf, sizeof(buf))) > 0)
+  { fwrite(buf, 1, n, out);
+    len -= n;
+  }
+}
+
+/* runs the handler with fds 1 and 2 sent to the capture files */
+static int runCaptured(ServeHandler handler, const ServeRequest * req, FileDestination * stages)
+{ int savedOut, savedErr, status;
+  fflush(stdout);
+  fflush(stderr);
+  rewindCapture(capturedOut);
+  rewindCapture(capturedErr);
+  savedOut = dup(STDOUT_FILENO);
+  savedErr = dup(STDERR_FILENO);
+  dup2(fileno(capturedOut), STDOUT_FILENO);
+  dup2(fileno(capturedErr), STDERR_FILENO);
+  *stages = 0;
+  status = handler(req, stages);
+  fflush(stdout);
+  fflush(stderr);
+  dup2(savedOut, STDOUT_FILENO);
+  dup2(savedErr, STDERR_FILENO);
+  close(savedOut);
+  close(savedErr);
+  return status;
+}
+
+/* one connection: returns FALSE after a quit request */
+static int serveConnection(int fd, ServeHandler handler)
+{ FILE * in = fdopen(fd, "r");
+  FILE * out = fdopen(dup(fd), "w");
+  ServeRequest req;
+  FileDestination stages;
+  int quit, status, i;
+  memset(&req, 0, sizeof(req));
+  if (in == NULL || out == NULL)
+  { if (in != NULL) fclose(in);
+    else close(fd);
+    if (out != NULL) fclose(out);
+    return TRUE;
+  }
+  if (! readRequest(in, &req, &quit))
+  { const char * message = "malformed request\n";
+    fprintf(out, "status 2\nstderr %zu\n%send\n", strlen(message), message);
+  }
+  else if (quit)
+    fprintf(out, "end\n");
+  else
+  { status = runCaptured(handler, &req, &stages);
+    fprintf(out, "status %d\n", status);
+    sendCapture(out, "stdout", capturedOut);
+    sendCapture(out, "stderr", capturedErr);
+    for (i = 0; i < (int) (sizeof(stageNames) / sizeof(stageNames[0])); i++)
+    { size_t len = 0;
+      char * stageText;
+      if (!(stages & stageNames[i].stage)) continue;
+      stageText = takeStageBuffer(stageNames[i].stage, &len);
+      fprintf(out, "stage %s %zu\n", stageNames[i].name, stageText ? len : 0);
+      if (stageText != NULL) fwrite(stageText, 1, len, out);
+      free(stageText);
+    }
+    fprintf(out, "end\n");
+  }
+  freeRequest(&req);
+  fclose(out);
+  fclose(in);
+  return ! quit;
+}
+
+int serve(const char * path, ServeHandler handler)
+{ struct sockaddr_un addr;
+  struct stat st;
+  int listener;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+  { fprintf(stderr, "socket path too long: %s\n", path);
+    return FALSE;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  /* a socket left by a server that did not stop cleanly */
+  if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 || bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+      listen(listener, 16) != 0)
+  { perror(path);
+    if (listener >= 0) close(listener);
+    return FALSE;
+  }
+  capturedOut = tmpfile();
+  capturedErr = tmpfile();
+  if (capturedOut == NULL || capturedErr == NULL)
+  { perror("tmpfile");
+    close(listener);
+    unlink(path);
+    return FALSE;
+  }
+  signal(SIGPIPE, SIG_IGN); /* a client that goes away only ends its connection */
+
+  for (;;)
+  { int fd = accept(listener, NULL, NULL);
+    if (fd < 0)
+    { if (errno == EINTR) continue;
+      perror("accept");
+      break;
+    }
+    if (! serveConnection(fd, handler)) break;
+  }
+  close(listener);
+  unlink(path);
+  fclose(capturedOut);
+  fclose(capturedErr);
+  free(text);
+  free(line);
+  text = line = NULL;
+  capText = capLine = 0;
+  return TRUE;
+}
@@ -0,0 +1,49 @@
+/****************************************************/
+/* File: serve.h                                    */
+/* Compile server over a Unix domain socket         */
+/* (mycmcomp --serve <socket>, tools/cmclient.c)    */
+/****************************************************/
+
+#ifndef _SERVE_H_
+#define _SERVE_H_
+
+#include "globals.h"
+
+/* Protocol, one request per connection. The request is
+ *
+ *   arg <option>\n           any number of compiler options
+ *   name <file name>\n       as on the command line
+ *   source <length>\n        followed by the bytes of the source
+ *
+ * or the single line "quit\n", which stops the server. The
+ * response is
+ *
+ *   status <n>\n
+ *   stdout <length>\n        followed by the bytes
+ *   stderr <length>\n        ditto
+ *   stage <stage> <length>\n ditto, for each stage file (err, lex,
+ *                            syn, tab, gen) the compilation opened
+ *   end\n
+ */
+
+#define SERVE_MAX_ARGS 32
+
+typedef struct
+{ const char * name;
+  const char * text;
+  size_t len;
+  char * args[SERVE_MAX_ARGS];
+  int nargs;
+} ServeRequest;
+
+/* compiles a request with stdout and stderr captured; returns
+ * the exit status of a standalone run, and in stages the stage
+ * files it opened (their text is taken with takeStageBuffer) */
+typedef int (*ServeHandler)(const ServeRequest * request, FileDestination * stages);
+
+/* serves requests on the socket at path, one at a time, until a
+ * quit request; every stage must be routed to ROUTE_MEMORY.
+ * Returns FALSE if the socket cannot be opened */
+int serve(const char * path, ServeHandler handler);
+
+#endif
@@ -13,6 +13,7 @@
 #include "util.h"
 #include "globals.h"
 #include "log.h"  /* para pc(...) e pce(...) */
+#include "dump.h"
 
 #define SIZE 211    /* tamanho da hash */
 #define SHIFT 4     /* para função hash */
@@ -32,15 +33,54 @@ typedef struct BucketListRec
     char *idType;          /* "fun", "var", "array" */
     char *dataType;        /* "int", "void", etc. */
     LineList lines;
+    int order;             /* posição na ordem de inserção */
     struct BucketListRec *next;
 } *BucketList;
 
 /* Tabela de símbolos global, implementada como hash */
 static BucketList hashTable[SIZE];
 
-/* Vetor para manter a ordem de inserção */
-static BucketList symbolArray[1000];
+/* Vetor para manter a ordem de inserção (cresce em dobro) */
+static BucketList *symbolArray = NULL;
 static int symbolCount = 0;
+static int symbolCapacity = 0;
+
+/*---------------------------------------------*/
+/* Contadores de instrumentação (--symtab-stats)*/
+/* Só existem se compilado com -DST_STATS;     */
+/* caso contrário as macros não geram código.  */
+/*---------------------------------------------*/
+#ifdef ST_STATS
+enum { STAT_LOOKUP, STAT_LOCAL, STAT_SYMTYPE, STAT_DATATYPE, STAT_NFUNCS };
+
+static const char *statNames[STAT_NFUNCS] =
+    { "st_lookup", "st_lookup_local", "st_symbolType", "st_dataType" };
+
+static struct
+{
+    long inserts;          /* chamadas a st_insert */
+    long insertsNew;       /* símbolos criados */
+    long insertsRedecl;    /* redeclarações detectadas */
+    long insertsUse;       /* usos (linhas) registrados */
+    long calls[STAT_NFUNCS];
+    long hits[STAT_NFUNCS];
+    long globalFallbacks;  /* buscas repetidas no escopo global */
+    long globalHits;       /* ... que encontraram o símbolo */
+    long walks;            /* percursos de cadeia */
+    long probes;           /* buckets comparados em todos os percursos */
+    long maxProbes;        /* maior número de buckets em um percurso */
+} stats;
+
+/* as buscas podem vir de várias threads (análise paralela) */
+#define ST_ADD(lv, n)    ((void)__atomic_fetch_add(&(lv), (n), __ATOMIC_RELAXED))
+#define ST_COUNT(field)  ST_ADD(stats.field, 1)
+#define ST_CALL(f)       ST_ADD(stats.calls[f], 1)
+#define ST_HIT(f, found) ((found) ? ST_ADD(stats.hits[f], 1) : (void)0)
+#else
+#define ST_COUNT(field)  ((void)0)
+#define ST_CALL(f)       ((void)0)
+#define ST_HIT(f, found) ((void)0)
+#endif
 
 /*---------------------------------------------*/
 /* Função hash: mapeia string -> índice        */
@@ -68,13 +108,91 @@ static int sameNameScope(BucketList b, const char *name, const char *scope)
 }
 
 /*---------------------------------------------*/
-/* Inicializa a Tabela de Símbolos             */
+/* Percorre a cadeia do bucket h procurando    */
+/* (name, scope); retorna o nó ou NULL         */
+/*---------------------------------------------*/
+static BucketList findBucket(int h, const char *name, const char *scope)
+{
+    BucketList l = hashTable[h];
+#ifdef ST_STATS
+    long steps = 0, max;
+    ST_COUNT(walks);
+    for (; l != NULL; l = l->next)
+    {
+        steps++;
+        if (sameNameScope(l, name, scope))
+            break;
+    }
+    ST_ADD(stats.probes, steps);
+    max = __atomic_load_n(&stats.maxProbes, __ATOMIC_RELAXED);
+    while (steps > max &&
+           !__atomic_compare_exchange_n(&stats.maxProbes, &max, steps, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+#else
+    while (l != NULL && !sameNameScope(l, name, scope))
+        l = l->next;
+#endif
+    return l;
+}
+
+/*---------------------------------------------*/
+/* Busca (name, scope) e, se não achar e scope */
+/* não for global, tenta o escopo global ("")  */
+/*---------------------------------------------*/
+static BucketList findWithGlobal(const char *name, const char *scope)
+{
+    int h = hash(name);
+    BucketList l = findBucket(h, name, scope);
+
+    if (l == NULL && strcmp(scope, "") != 0)
+    {
+        ST_COUNT(globalFallbacks);
+        l = findBucket(h, name, "");
+        if (l != NULL)
+            ST_COUNT(globalHits);
+    }
+    return l;
+}
+
+/*---------------------------------------------*/
+/* Libera um símbolo, suas linhas e cópias     */
+/*---------------------------------------------*/
+static void freeBucket(BucketList b)
+{
+    while (b->lines != NULL)
+    {
+        LineList next = b->lines->next;
+        free(b->lines);
+        b->lines = next;
+    }
+    free(b->name);
+    free(b->scope);
+    free(b->idType);
+    free(b->dataType);
+    free(b);
+}
+
+/*---------------------------------------------*/
+/* Inicializa a Tabela de Símbolos, liberando  */
+/* a da compilação anterior (lote, --serve e   */
+/* --watch compilam vários arquivos)           */
 /*---------------------------------------------*/
 void st_init(void)
 {
     for (int i = 0; i < SIZE; i++)
-        hashTable[i] = NULL;
+    {
+        while (hashTable[i] != NULL)
+        {
+            BucketList next = hashTable[i]->next;
+            freeBucket(hashTable[i]);
+            hashTable[i] = next;
+        }
+    }
     symbolCount = 0;
+#ifdef ST_STATS
+    memset(&stats, 0, sizeof(stats));
+#endif
 }
 
 /*-------------------------------------------------------*/
@@ -132,28 +250,32 @@ int st_insert(const char *name, int lineno,
               const char *dataType)
 {
     int h = hash(name);
-    BucketList l = hashTable[h];
-    BucketList prev = NULL;
+    BucketList l;
+
+    ST_COUNT(inserts);
 
     /* Tenta achar (name, scope) na lista ligada */
-    while (l != NULL && !sameNameScope(l, name, scope))
-    {
-        prev = l;
-        l = l->next;
-    }
+    l = findBucket(h, name, scope);
 
     if (l == NULL)
     {
-        /* Não achou => cria um novo bucket e adiciona */
+        /* Não achou => cria um novo bucket e adiciona no início da cadeia
+         * (a ordem da cadeia não importa: (name, scope) é único) */
         BucketList newB = newBucket(name, scope, idType, dataType, lineno);
 
-        if (prev == NULL)
-            hashTable[h] = newB;
-        else
-            prev->next = newB;
+        newB->next   = hashTable[h];
+        hashTable[h] = newB;
 
         /* Salva no array para impressão na ordem de inserção */
+        if (symbolCount == symbolCapacity)
+        {
+            symbolCapacity = symbolCapacity ? 2 * symbolCapacity : 1024;
+            symbolArray = (BucketList *)realloc(symbolArray,
+                                                symbolCapacity * sizeof(BucketList));
+        }
+        newB->order = symbolCount;
         symbolArray[symbolCount++] = newB;
+        ST_COUNT(insertsNew);
         return 0; /* Inseriu novo */
     }
     else
@@ -162,6 +284,7 @@ int st_insert(const char *name, int lineno,
         if (idType != NULL)
         {
             /* Achou declaração já existente no escopo atual => redeclaração */
+            ST_COUNT(insertsRedecl);
             return 1; 
         }
         else
@@ -169,6 +292,7 @@ int st_insert(const char *name, int lineno,
             /* É uso => só adiciona linha de uso, se ainda não existir */
             if (lineno != 0 && !alreadyHasLine(l->lines, lineno))
             {
+                ST_COUNT(insertsUse);
                 if (l->lines == NULL)
                 {
                     LineList ll  = (LineList)malloc(sizeof(*ll));
@@ -198,30 +322,11 @@ int st_insert(const char *name, int lineno,
 /*------------------------------------------------------------*/
 int st_lookup(const char *name, const char *scope)
 {
-    int h = hash(name);
-    BucketList l = hashTable[h];
+    BucketList l = findWithGlobal(name, scope);
 
-    /* 1) Tenta achar (name, scope) exato */
-    while (l != NULL)
-    {
-        if (sameNameScope(l, name, scope))
-            return 1;
-        l = l->next;
-    }
-
-    /* 2) Se não achou e scope != "", procura no escopo global ("") */
-    if (strcmp(scope, "") != 0)
-    {
-        h = hash(name);
-        l = hashTable[h];
-        while (l != NULL)
-        {
-            if (sameNameScope(l, name, ""))
-                return 1;
-            l = l->next;
-        }
-    }
-    return 0;
+    ST_CALL(STAT_LOOKUP);
+    ST_HIT(STAT_LOOKUP, l != NULL);
+    return (l != NULL);
 }
 
 /*------------------------------------------------------------*/
@@ -230,16 +335,11 @@ int st_lookup(const char *name, const char *scope)
 /*------------------------------------------------------------*/
 int st_lookup_local(const char *name, const char *scope)
 {
-    int h = hash(name);
-    BucketList l = hashTable[h];
+    BucketList l = findBucket(hash(name), name, scope);
 
-    while (l != NULL)
-    {
-        if (sameNameScope(l, name, scope))
-            return 1;
-        l = l->next;
-    }
-    return 0;
+    ST_CALL(STAT_LOCAL);
+    ST_HIT(STAT_LOCAL, l != NULL);
+    return (l != NULL);
 }
 
 /*------------------------------------------------------------*/
@@ -248,30 +348,11 @@ int st_lookup_local(const char *name, const char *scope)
 /*------------------------------------------------------------*/
 char* st_symbolType(const char *name, const char *scope)
 {
-    int h = hash(name);
-    BucketList l = hashTable[h];
+    BucketList l = findWithGlobal(name, scope);
 
-    /* 1) Tenta achar (name,scope) exato */
-    while (l != NULL)
-    {
-        if (sameNameScope(l, name, scope))
-            return l->idType;
-        l = l->next;
-    }
-
-    /* 2) Se não achou, tenta no escopo global */
-    if (strcmp(scope, "") != 0)
-    {
-        h = hash(name);
-        l = hashTable[h];
-        while (l != NULL)
-        {
-            if (sameNameScope(l, name, ""))
-                return l->idType;
-            l = l->next;
-        }
-    }
-    return NULL;
+    ST_CALL(STAT_SYMTYPE);
+    ST_HIT(STAT_SYMTYPE, l != NULL);
+    return (l != NULL) ? l->idType : NULL;
 }
 
 /*------------------------------------------------------------*/
@@ -280,61 +361,166 @@ char* st_symbolType(const char *name, const char *scope)
 /*------------------------------------------------------------*/
 char* st_dataType(const char *name, const char *scope)
 {
-    int h = hash(name);
-    BucketList l = hashTable[h];
+    BucketList l = findWithGlobal(name, scope);
 
-    /* 1) Tenta achar (name, scope) exato */
-    while (l != NULL)
-    {
-        if (sameNameScope(l, name, scope))
-            return l->dataType;
-        l = l->next;
-    }
+    ST_CALL(STAT_DATATYPE);
+    ST_HIT(STAT_DATATYPE, l != NULL);
+    return (l != NULL) ? l->dataType : NULL;
+}
 
-    /* 2) Se não achou, tenta escopo global */
-    if (strcmp(scope, "") != 0)
-    {
-        h = hash(name);
-        l = hashTable[h];
-        while (l != NULL)
-        {
-            if (sameNameScope(l, name, ""))
-                return l->dataType;
-            l = l->next;
-        }
-    }
-    return NULL;
+/*------------------------------------------------------------*/
+/* st_order: Posição de (name, scope) exato na ordem de       */
+/* inserção, ou -1 se não achar                               */
+/*------------------------------------------------------------*/
+int st_order(const char *name, const char *scope)
+{
+    BucketList l = findBucket(hash(name), name, scope);
+    return (l != NULL) ? l->order : -1;
 }
 
 /*------------------------------------------------------------*/
-/* printSymTab: Imprime a Tabela de Símbolos na ordem         */
-/* de inserção (symbolArray[0..symbolCount-1]).               */
+/* st_count: Número de símbolos inseridos                     */
 /*------------------------------------------------------------*/
-void printSymTab(void)
+int st_count(void)
+{
+    return symbolCount;
+}
+
+/*------------------------------------------------------------*/
+/* printSymHeader / printSymRow: o formato da listagem da TS, */
+/* usado também por dump.c ao reproduzir um dump binário      */
+/*------------------------------------------------------------*/
+void printSymHeader(void)
 {
     pc("Variable Name  Scope     ID Type  Data Type  Line Numbers\n");
     pc("-------------  --------  -------  ---------  -------------------------\n");
+}
+
+void printSymRow(const char *name, const char *scope,
+                 const char *idType, const char *dataType,
+                 const int *lines, int nLines)
+{
+    pc("%-14s ", name);
+    pc("%-9s ", scope);
+    pc("%-8s ", idType);
+    pc("%-10s ", dataType);
+
+    /* Imprime as linhas onde o símbolo aparece */
+    for (int i = 0; i < nLines; i++)
+        pc("%2d ", lines[i]);
+    pc("\n");
+}
+
+/*------------------------------------------------------------*/
+/* printSymTab: Imprime a Tabela de Símbolos na ordem         */
+/* de inserção (symbolArray[0..symbolCount-1]), em texto ou   */
+/* como registros do dump binário                             */
+/*------------------------------------------------------------*/
+void printSymTab(void)
+{
+    static int *lines = NULL;
+    static int capLines = 0;
+
+    /* Com o dump aberto, a tabela em texto vai só para o stdout */
+    if (dumpActive())
+    {
+        dumpSymbolHeader();
+        onlyStdout(TRUE);
+    }
+    printSymHeader();
 
     for (int i = 0; i < symbolCount; i++)
     {
         BucketList b = symbolArray[i];
-        char *name = b->name;
-        char *scp  = b->scope;
         char *idt  = (b->idType)   ? b->idType   : "";
         char *dt   = (b->dataType) ? b->dataType : "";
+        int n = 0;
 
-        pc("%-14s ", name);
-        pc("%-9s ", scp);
-        pc("%-8s ", idt);
-        pc("%-10s ", dt);
-
-        /* Imprime as linhas onde o símbolo aparece */
-        LineList t = b->lines;
-        while (t != NULL)
+        for (LineList t = b->lines; t != NULL; t = t->next)
         {
-            pc("%2d ", t->lineno);
-            t = t->next;
+            if (n == capLines)
+            {
+                capLines = capLines ? 2 * capLines : 64;
+                lines = (int *)realloc(lines, capLines * sizeof(int));
+            }
+            lines[n++] = t->lineno;
         }
-        pc("\n");
+
+        if (dumpActive())
+            dumpSymbol(b->name, b->scope, idt, dt, lines, n);
+        printSymRow(b->name, b->scope, idt, dt, lines, n);
     }
-}
\ No newline at end of file
+    onlyStdout(FALSE);
+}
+
+/*------------------------------------------------------------*/
+/* st_printStats: Imprime os contadores de acesso à TS, em    */
+/* texto ou JSON. Sem -DST_STATS só informa que não há dados. */
+/*------------------------------------------------------------*/
+void st_printStats(FILE *out, int json)
+{
+#ifdef ST_STATS
+    int used = 0, maxChain = 0;
+    long totalCalls = 0, totalHits = 0;
+
+    for (int i = 0; i < SIZE; i++)
+    {
+        int len = 0;
+        for (BucketList l = hashTable[i]; l != NULL; l = l->next)
+            len++;
+        if (len > 0) used++;
+        if (len > maxChain) maxChain = len;
+    }
+    for (int f = 0; f < STAT_NFUNCS; f++)
+    {
+        totalCalls += stats.calls[f];
+        totalHits  += stats.hits[f];
+    }
+
+    double loadFactor = (double)symbolCount / SIZE;
+    double avgProbes  = stats.walks ? (double)stats.probes / stats.walks : 0.0;
+    double avgChain   = used ? (double)symbolCount / used : 0.0;
+
+    if (json)
+    {
+        fprintf(out, "{\"symbols\": %d, \"buckets\": %d, \"usedBuckets\": %d, "
+                     "\"loadFactor\": %.4f, \"maxChain\": %d, \"avgChain\": %.4f,\n",
+                symbolCount, SIZE, used, loadFactor, maxChain, avgChain);
+        fprintf(out, " \"inserts\": {\"calls\": %ld, \"new\": %ld, \"redeclared\": %ld, \"uses\": %ld},\n",
+                stats.inserts, stats.insertsNew, stats.insertsRedecl, stats.insertsUse);
+        fprintf(out, " \"lookups\": {");
+        for (int f = 0; f < STAT_NFUNCS; f++)
+            fprintf(out, "%s\"%s\": {\"calls\": %ld, \"hits\": %ld}",
+                    f ? ", " : "", statNames[f], stats.calls[f], stats.hits[f]);
+        fprintf(out, "},\n");
+        fprintf(out, " \"globalFallbacks\": %ld, \"globalFallbackHits\": %ld,\n",
+                stats.globalFallbacks, stats.globalHits);
+        fprintf(out, " \"chainWalks\": %ld, \"probes\": %ld, \"avgProbes\": %.4f, \"maxProbes\": %ld}\n",
+                stats.walks, stats.probes, avgProbes, stats.maxProbes);
+        return;
+    }
+
+    fprintf(out, "\nSymbol table statistics:\n\n");
+    fprintf(out, "symbols            %d\n", symbolCount);
+    fprintf(out, "buckets            %d (%d used)\n", SIZE, used);
+    fprintf(out, "load factor        %.4f\n", loadFactor);
+    fprintf(out, "max chain length   %d\n", maxChain);
+    fprintf(out, "avg chain (used)   %.4f\n", avgChain);
+    fprintf(out, "inserts            %ld (new %ld, redeclared %ld, uses %ld)\n",
+            stats.inserts, stats.insertsNew, stats.insertsRedecl, stats.insertsUse);
+    for (int f = 0; f < STAT_NFUNCS; f++)
+        fprintf(out, "%-18s %ld calls, %ld hits (%.1f%%)\n", statNames[f],
+                stats.calls[f], stats.hits[f],
+                stats.calls[f] ? 100.0 * stats.hits[f] / stats.calls[f] : 0.0);
+    fprintf(out, "lookup hit rate    %.1f%%\n",
+            totalCalls ? 100.0 * totalHits / totalCalls : 0.0);
+    fprintf(out, "global fallbacks   %ld (%ld hits)\n", stats.globalFallbacks, stats.globalHits);
+    fprintf(out, "chain walks        %ld, probes %ld (avg %.2f, max %ld)\n",
+            stats.walks, stats.probes, avgProbes, stats.maxProbes);
+#else
+    if (json)
+        fprintf(out, "{\"error\": \"symtab statistics not compiled in (build with -DST_STATS)\"}\n");
+    else
+        fprintf(out, "symtab statistics not compiled in (build with -DST_STATS)\n");
+#endif
+}
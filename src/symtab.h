@@ -5,6 +5,8 @@
 #ifndef _SYMTAB_H_
 #define _SYMTAB_H_
 
+#include <stdio.h>
+
 /* Inicializa a tabela de símbolos */
 void st_init(void);
 
@@ -34,7 +36,24 @@ int st_insert(const char *name, int lineno,
               const char *idType,
               const char *dataType);
 
+/* Retorna a posição de (name, scope) exato na ordem de inserção,
+   ou -1 se não achar */
+int st_order(const char *name, const char *scope);
+
+/* Retorna o número de símbolos inseridos */
+int st_count(void);
+
 /* Imprime a Tabela de Símbolos */
 void printSymTab(void);
 
+/* Cabeçalho e uma linha da listagem da TS */
+void printSymHeader(void);
+void printSymRow(const char *name, const char *scope,
+                 const char *idType, const char *dataType,
+                 const int *lines, int nLines);
+
+/* Imprime as estatísticas de acesso à TS (texto ou JSON se 'json').
+   Os contadores só existem se compilado com -DST_STATS */
+void st_printStats(FILE *out, int json);
+
 #endif
@@ -53,8 +53,8 @@ void printToken( TokenType token, const char* tokenString )
       pc(
           "ID, name= %s\n",tokenString);
       break;
-    case ERROR:
-      pce(
+    case ERROR: /* the error itself is reported by the scanner (diag.h) */
+      pc(
           "ERROR: %s\n",tokenString);
       break;
     default: /* should never happen */
@@ -76,6 +76,8 @@ TreeNode * newStmtNode(StmtKind kind)
     t->nodekind = StmtK;
     t->kind.stmt = kind;
     t->lineno = lineno;
+    t->offset = 0;
+    t->decl = NULL;
   }
   return t;
 }
@@ -94,6 +96,8 @@ TreeNode * newExpNode(ExpKind kind)
     t->nodekind = ExpK;
     t->kind.exp = kind;
     t->lineno = lineno;
+    t->offset = 0;
+    t->decl = NULL;
     t->type = VoidType;
   }
   return t;
@@ -114,6 +118,33 @@ char * copyString(char * s)
   return t;
 }
 
+/* Function countNodes returns the number of nodes
+ * of tree and its children, but not of its siblings
+ */
+int countNodes(TreeNode * tree)
+{ int i, n = 1;
+  TreeNode * t;
+  if (tree==NULL) return 0;
+  for (i=0;i<MAXCHILDREN;i++)
+    for (t=tree->child[i];t!=NULL;t=t->sibling)
+      n += countNodes(t);
+  return n;
+}
+
+/* Procedure freeTree frees tree, its children
+ * and its siblings, with the names of the ids
+ */
+void freeTree(TreeNode * tree)
+{ int i;
+  while (tree!=NULL)
+  { TreeNode * next = tree->sibling;
+    for (i=0;i<MAXCHILDREN;i++) freeTree(tree->child[i]);
+    if (tree->nodekind==IdK) free(tree->attr.name);
+    free(tree);
+    tree = next;
+  }
+}
+
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
@@ -125,9 +156,7 @@ static int indentno = 0;
 
 /* printSpaces indents by printing spaces */
 static void printSpaces(void)
-{ int i;
-  for (i=0;i<indentno;i++)
-    pc(" ");
+{ pc("%*s",indentno,"");
 }
 
 void printTree(TreeNode *tree)
@@ -378,6 +407,8 @@ TreeNode *newTypeNode(TypeKind kind)
       t->nodekind = TypeK;
       t->kind.type = kind;
       t->lineno = lineno;
+      t->offset = 0;
+      t->decl = NULL;
   }
   return t;
 }
@@ -397,6 +428,8 @@ TreeNode *newIdNode(IdKind kind)
     t->nodekind = IdK;
     t->kind.id = kind;
     t->lineno = lineno;
+    t->offset = 0;
+    t->decl = NULL;
   }
   return t;
 }
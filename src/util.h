@@ -10,6 +10,8 @@ void printToken(TokenType token, const char* tokenString);
 TreeNode * newStmtNode(StmtKind);
 TreeNode * newExpNode(ExpKind);
 char * copyString(char *);
+int countNodes(TreeNode *);
+void freeTree(TreeNode *);
 
 /* etc... */
 void printTree(TreeNode * );
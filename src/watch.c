@@ -0,0 +1,138 @@
+/****************************************************/
+/* File: watch.c                                    */
+/* Recompiles the sources of a directory as they    */
+/* change, with inotify                             */
+/****************************************************/
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "globals.h"
+#include "util.h"
+#include "watch.h"
+
+/* files compiled at once: the changes seen by one wakeup */
+#define MAX_PENDING 256
+
+static volatile sig_atomic_t stopped = FALSE;
+
+static void stop(int sig)
+{ (void) sig;
+  stopped = TRUE;
+}
+
+static int isSource(const char * name)
+{ size_t n = strlen(name);
+  return n > 3 && strcmp(name + n - 3, ".cm") == 0 && name[0] != '.';
+}
+
+static double now(void)
+{ struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static void compileOne(const char * dir, const char * name, WatchHandler handler)
+{ char file[1024];
+  double start = now();
+  int status;
+  snprintf(file, sizeof(file), "%s/%s", dir, name);
+  status = handler(file);
+  printf("%s: %s (%.1f ms)\n", file, status == 0 ? "ok" : "FAIL", now() - start);
+  fflush(stdout);
+}
+
+static int selectSource(const struct dirent * d)
+{ return isSource(d->d_name);
+}
+
+/* the first pass: every source, in name order */
+static void compileAll(const char * dir, WatchHandler handler)
+{ struct dirent ** names;
+  int i, n = scandir(dir, &names, selectSource, alphasort);
+  for (i = 0; i < n; i++)
+  { if (! stopped) compileOne(dir, names[i]->d_name, handler);
+    free(names[i]);
+  }
+  if (n >= 0) free(names);
+}
+
+/* adds name to pending unless it is there already */
+static int addPending(char ** pending, int n, const char * name)
+{ int i;
+  for (i = 0; i < n; i++)
+    if (strcmp(pending[i], name) == 0) return n;
+  if (n == MAX_PENDING) return n;
+  pending[n] = copyString((char *) name);
+  return n + 1;
+}
+
+int watch(const char * dir, WatchHandler handler)
+{ char path[1024];
+  char buf[16384] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  char * pending[MAX_PENDING];
+  struct sigaction sa;
+  struct pollfd pfd;
+  int fd, wd, gone = FALSE;
+  size_t len;
+
+  snprintf(path, sizeof(path), "%s", dir);
+  len = strlen(path);
+  while (len > 1 && path[len - 1] == '/') path[--len] = '\0';
+
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+  { perror("inotify_init1");
+    return FALSE;
+  }
+  /* editors either rewrite the file or move a new one over it */
+  wd = inotify_add_watch(fd, path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+  if (wd < 0)
+  { perror(path);
+    close(fd);
+    return FALSE;
+  }
+  /* no SA_RESTART: poll returns at the signal */
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stop;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  compileAll(path, handler);
+  fprintf(stderr, "watching %s (Ctrl-C to stop)\n", path);
+
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  while (! stopped && ! gone)
+  { ssize_t n;
+    int nPending = 0, i;
+    if (poll(&pfd, 1, -1) < 0)
+    { if (errno == EINTR) continue;
+      perror("poll");
+      break;
+    }
+    /* everything queued so far: a save often comes as several events */
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+    { char * p;
+      for (p = buf; p < buf + n; p += sizeof(struct inotify_event) + ((struct inotify_event *) p)->len)
+      { struct inotify_event * e = (struct inotify_event *) p;
+        if (e->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) gone = TRUE;
+        else if (e->len > 0 && isSource(e->name))
+          nPending = addPending(pending, nPending, e->name);
+      }
+    }
+    for (i = 0; i < nPending; i++)
+    { if (! stopped) compileOne(path, pending[i], handler);
+      free(pending[i]);
+    }
+  }
+  if (gone) fprintf(stderr, "%s is gone\n", path);
+  close(fd);
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  return TRUE;
+}
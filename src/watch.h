@@ -0,0 +1,20 @@
+/****************************************************/
+/* File: watch.h                                    */
+/* Recompiles the sources of a directory as they    */
+/* change (mycmcomp --watch <dir>)                  */
+/****************************************************/
+
+#ifndef _WATCH_H_
+#define _WATCH_H_
+
+/* compiles file; returns 0 if it matches its golden files (or
+ * there are none), nonzero otherwise */
+typedef int (*WatchHandler)(const char * file);
+
+/* compiles every .cm file of dir, then each one again whenever
+ * it is written or moved into dir, until SIGINT or SIGTERM. One
+ * line per compilation on stdout: the file, ok or FAIL, and the
+ * milliseconds it took. Returns FALSE if dir cannot be watched */
+int watch(const char * dir, WatchHandler handler);
+
+#endif
@@ -303,6 +303,13 @@ int readInstructions (void)
 } /* readInstructions */
 
 
+/********************************************/
+/* reads a line of the terminal into in_Line, without the newline */
+void readLine (void)
+{ if (fgets(in_Line, LINESIZE, stdin) == NULL) in_Line[0] = '\0' ;
+  else in_Line[strcspn(in_Line, "\r\n")] = '\0' ;
+}
+
 /********************************************/
 STEPRESULT stepTM (void)
 { INSTRUCTION currentinstruction  ;
@@ -354,7 +361,7 @@ STEPRESULT stepTM (void)
       { printf("Enter value for IN instruction: ") ;
         fflush (stdin);
         fflush (stdout);
-        gets(in_Line);
+        readLine();
         lineLen = strlen(in_Line) ;
         inCol = 0;
         ok = getNum();
@@ -407,7 +414,7 @@ int doCommand (void)
   { printf ("Enter command: ");
     fflush (stdin);
     fflush (stdout);
-    gets(in_Line);
+    readLine();
     lineLen = strlen(in_Line);
     inCol = 0;
   }
@@ -557,7 +564,7 @@ int doCommand (void)
 /* E X E C U T I O N   B E G I N S   H E R E */
 /********************************************/
 
-main( int argc, char * argv[] )
+int main( int argc, char * argv[] )
 { if (argc != 2)
   { printf("usage: %s <filename>\n",argv[0]);
     exit(1);
@@ -0,0 +1,195 @@
+/****************************************************/
+/* File: cmclient.c                                 */
+/* Client of mycmcomp --serve: sends a source to    */
+/* the running compiler and writes its outputs as a */
+/* standalone run would                             */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#define MAX_ARGS 32
+
+/* file of each stage, after the base name of the source */
+static const struct { const char * name; const char * suffix; } stageFiles[] =
+{ { "err", "_err.txt" }, { "lex", "_lex.txt" }, { "syn", "_syn.txt" },
+  { "tab", "_tab.txt" }, { "gen", "_gen.tm" } };
+
+static void usage(const char * prog)
+{ fprintf(stderr,"usage: %s --socket=PATH [options] <filename> [<detailpath>]\n",prog);
+  fprintf(stderr,"       %s --socket=PATH --quit\n",prog);
+  fprintf(stderr,"the options are those of mycmcomp a request may give: --lex-only,\n");
+  fprintf(stderr,"-fsyntax-only, --no-codegen, --trace=, --log=, --max-errors=, --jobs=,\n");
+  fprintf(stderr,"--diag-format=, --symtab-stats, --frame-report and --callgraph\n");
+  fprintf(stderr,"  --quit               stop the server\n");
+  exit(2);
+}
+
+static int connectTo(const char * path)
+{ struct sockaddr_un addr;
+  int fd;
+  if (strlen(path) >= sizeof(addr.sun_path))
+  { fprintf(stderr,"socket path too long: %s\n",path);
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+  { perror(path);
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* reads the whole file; NULL if it cannot be opened */
+static char * readFile(const char * name, long * len)
+{ FILE * f = fopen(name, "rb");
+  char * text;
+  if (f == NULL) return NULL;
+  fseek(f, 0, SEEK_END);
+  *len = ftell(f);
+  rewind(f);
+  text = (char *) malloc(*len + 1);
+  if (text == NULL || fread(text, 1, *len, f) != (size_t) *len)
+  { free(text);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  return text;
+}
+
+/* copies len bytes of the response to out (if not NULL) */
+static int copyPart(FILE * in, long len, FILE * out)
+{ char buf[8192];
+  while (len > 0)
+  { size_t n = fread(buf, 1, len < (long) sizeof(buf) ? (size_t) len : sizeof(buf), in);
+    if (n == 0) return FALSE;
+    if (out != NULL) fwrite(buf, 1, n, out);
+    len -= n;
+  }
+  return TRUE;
+}
+
+/* the stage file in detailpath, named as the compiler names it */
+static FILE * openStage(const char * detailpath, const char * pgm, const char * stage)
+{ char base[256], file[1024];
+  const char * start = strrchr(pgm, '/') ? strrchr(pgm, '/') + 1 : pgm;
+  const char * dot = strrchr(start, '.');
+  int i;
+  snprintf(base, sizeof(base), "%.*s", dot ? (int) (dot - start) : (int) strlen(start), start);
+  for (i = 0; i < (int) (sizeof(stageFiles) / sizeof(stageFiles[0])); i++)
+    if (strcmp(stageFiles[i].name, stage) == 0)
+    { FILE * f;
+      snprintf(file, sizeof(file), "%s/%s%s", detailpath, base, stageFiles[i].suffix);
+      f = fopen(file, "w");
+      if (f == NULL) perror(file);
+      return f;
+    }
+  fprintf(stderr,"unknown stage in the response: %s\n",stage);
+  return NULL;
+}
+
+/* reads the response up to "end"; returns its status, or 2 if
+ * it is cut short */
+static int readResponse(FILE * in, const char * detailpath, const char * pgm)
+{ char line[256], key[32], stage[32];
+  long len;
+  int status = 2;
+  while (fgets(line, sizeof(line), in) != NULL)
+  { if (strcmp(line, "end\n") == 0) return status;
+    if (sscanf(line, "status %d", &status) == 1) continue;
+    if (sscanf(line, "stage %31s %ld", stage, &len) == 2)
+    { FILE * f = openStage(detailpath, pgm, stage);
+      int ok = copyPart(in, len, f);
+      if (f != NULL) fclose(f);
+      if (! ok) break;
+    }
+    else if (sscanf(line, "%31s %ld", key, &len) == 2 &&
+             (strcmp(key, "stdout") == 0 || strcmp(key, "stderr") == 0))
+    { if (! copyPart(in, len, strcmp(key, "stdout") == 0 ? stdout : stderr)) break;
+    }
+    else break;
+  }
+  fprintf(stderr,"incomplete response from the server\n");
+  return 2;
+}
+
+int main( int argc, char * argv[] )
+{ const char * socketPath = NULL;
+  const char * args[MAX_ARGS];
+  const char * files[2];
+  char pgm[1024];
+  int nargs = 0, nfiles = 0, quit = FALSE;
+  int fd, status, i;
+  FILE * in, * out;
+  char * text;
+  long len;
+
+  for (i = 1; i < argc; i++)
+  { if (strncmp(argv[i],"--socket=",9) == 0)
+      socketPath = argv[i] + 9;
+    else if (strcmp(argv[i],"--quit") == 0)
+      quit = TRUE;
+    else if (argv[i][0] == '-')
+    { if (nargs == MAX_ARGS) usage(argv[0]);
+      args[nargs++] = argv[i];
+    }
+    else
+    { if (nfiles == 2) usage(argv[0]);
+      files[nfiles++] = argv[i];
+    }
+  }
+  if (socketPath == NULL || (! quit && nfiles == 0)) usage(argv[0]);
+
+  fd = connectTo(socketPath);
+  if (fd < 0) return 2;
+  /* a stream is either read or written on a socket */
+  out = fdopen(fd, "w");
+  in = fdopen(dup(fd), "r");
+  if (quit)
+  { char line[16];
+    fprintf(out, "quit\n");
+    fflush(out);
+    status = fgets(line, sizeof(line), in) != NULL && strcmp(line, "end\n") == 0 ? 0 : 2;
+    fclose(out);
+    fclose(in);
+    return status;
+  }
+
+  snprintf(pgm, sizeof(pgm), "%s", files[0]);
+  if (strchr(pgm, '.') == NULL)
+    strncat(pgm, ".cm", sizeof(pgm) - strlen(pgm) - 1); /* as mycmcomp: .cm if no extension */
+  text = readFile(pgm, &len);
+  if (text == NULL)
+  { fprintf(stderr,"File %s not found\n",pgm);
+    fclose(out);
+    fclose(in);
+    return 1;
+  }
+  for (i = 0; i < nargs; i++)
+    fprintf(out, "arg %s\n", args[i]);
+  fprintf(out, "name %s\nsource %ld\n", pgm, len);
+  fwrite(text, 1, len, out);
+  fflush(out);
+  free(text);
+
+  status = readResponse(in, nfiles == 2 ? files[1] : "/tmp/", pgm);
+  fclose(out);
+  fclose(in);
+  return status;
+}
@@ -0,0 +1,53 @@
+/****************************************************/
+/* File: cmdump.c                                   */
+/* Renders a binary dump of mycmcomp (--binary-dump)*/
+/* back to the text listings _lex, _syn and _tab    */
+/****************************************************/
+
+#include "globals.h"
+#include "dump.h"
+
+/* util.c stamps new nodes with the current line */
+int lineno = 0;
+
+static void usage(const char * prog)
+{ fprintf(stderr,"usage: %s [-s lex|syn|tab]... <file.cmb> [<detailpath>]\n",prog);
+  fprintf(stderr,"  renders the listings of the stages chosen with -s (default all):\n");
+  fprintf(stderr,"  into <detailpath>/<name>_<stage>.txt, or on stdout without detailpath\n");
+  exit(1);
+}
+
+int main( int argc, char * argv[] )
+{ FileDestination stages = 0;
+  char * args[2]; /* positional arguments: file, detailpath */
+  int nargs = 0;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  { if (strcmp(argv[i],"-s") == 0 && i + 1 < argc)
+    { i++;
+      if (strcmp(argv[i],"lex") == 0) stages |= LEX;
+      else if (strcmp(argv[i],"syn") == 0) stages |= SYN;
+      else if (strcmp(argv[i],"tab") == 0) stages |= TAB;
+      else usage(argv[0]);
+    }
+    else if (argv[i][0] == '-')
+      usage(argv[0]);
+    else if (nargs < 2)
+      args[nargs++] = argv[i];
+    else usage(argv[0]);
+  }
+  if (nargs < 1)
+    usage(argv[0]);
+  if (stages == 0)
+    stages = LEX | SYN | TAB;
+
+  mirrorStdout(FALSE);
+  routeStage(LEX | SYN | TAB, ROUTE_DISCARD);
+  routeStage(stages, nargs == 2 ? ROUTE_FILE : ROUTE_STDOUT);
+  if (! dumpRender(args[0], nargs == 2 ? args[1] : "/tmp/", stages))
+  { fprintf(stderr,"%s: not a dump, or truncated: %s\n",argv[0],args[0]);
+    return 1;
+  }
+  return 0;
+}
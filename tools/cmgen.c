@@ -0,0 +1,592 @@
+/****************************************************/
+/* File: cmgen.c                                    */
+/* Generator of synthetic C- programs for scaling   */
+/* and stress tests: valid programs of a given      */
+/* shape, or the same programs with errors injected */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#define ARRAY_SIZE 10
+#define MAX_PARAMS 3
+
+/* the errors --invalid can inject, one per compiler error path;
+ * redeclared-function is a variable with the name of a function */
+typedef enum
+{ LEXICAL, SYNTAX, UNDECLARED, VOID_VARIABLE, REDECL_VARIABLE,
+  REDECL_FUNCTION, VOID_USE, NO_MAIN, NKINDS
+} Kind;
+
+static const char * kindNames[NKINDS] =
+{ "lexical", "syntax", "undeclared", "void-variable", "redeclared-variable",
+  "redeclared-function", "void-use", "no-main" };
+
+/* the shape of the program */
+static long functions = 10;      /* --functions */
+static int statements = 5;       /* --statements, per block */
+static int depth = 2;            /* --depth, of nested blocks */
+static int exprDepth = 3;        /* --expr-depth */
+static int identifiers = 6;      /* --identifiers, locals per function */
+static int identLength = 6;      /* --ident-length */
+static int commentDensity = 10;  /* --comments, % of the statements */
+static int lineLength = 80;      /* --line-length */
+static unsigned long seed = 1;   /* --seed */
+static int invalid = 0;          /* --invalid, one bit per Kind */
+
+/* the program is drawn from one stream and the places of the
+ * errors from another, so a variant is its valid program with
+ * only the errors added */
+static unsigned long long shapeState, faultState;
+
+static FILE * out;
+static int column = 0;   /* 0 at the start of a line */
+static int indent = 0;
+static long line = 1;
+
+/* splitmix64: small, and the same sequence on every platform */
+static unsigned long long next(unsigned long long * state)
+{ unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static long pick(long n)
+{ return n > 0 ? (long) (next(&shapeState) % (unsigned long long) n) : 0;
+}
+
+static int chance(int percent)
+{ return pick(100) < percent;
+}
+
+static void usage(const char * prog)
+{ int k;
+  fprintf(stderr,"usage: %s [options] [-o file.cm]\n",prog);
+  fprintf(stderr,"options:\n");
+  fprintf(stderr,"  --seed=N             seed of the generator (default 1)\n");
+  fprintf(stderr,"  --functions=N        functions besides main (default 10)\n");
+  fprintf(stderr,"  --statements=N       statements per block (default 5)\n");
+  fprintf(stderr,"  --depth=N            nesting depth of if and while blocks (default 2)\n");
+  fprintf(stderr,"  --expr-depth=N       depth of the expressions (default 3)\n");
+  fprintf(stderr,"  --identifiers=N      local variables per function (default 6)\n");
+  fprintf(stderr,"  --ident-length=N     length of the identifiers (default 6)\n");
+  fprintf(stderr,"  --comments=PERCENT   statements preceded by a comment (default 10)\n");
+  fprintf(stderr,"  --line-length=N      wrap the lines at N columns (default 80)\n");
+  fprintf(stderr,"  --invalid=LIST       inject one error of each kind of LIST:\n                      ");
+  for (k = 0; k < NKINDS; k++)
+    fprintf(stderr," %s",kindNames[k]);
+  fprintf(stderr,"\n                       or all; their lines go to stderr\n");
+  exit(2);
+}
+
+static int parseKinds(const char * list)
+{ int mask = 0;
+  if (strcmp(list,"all") == 0) return (1 << NKINDS) - 1;
+  while (*list != '\0')
+  { size_t len = strcspn(list,",");
+    int k;
+    for (k = 0; k < NKINDS; k++)
+      if (strlen(kindNames[k]) == len && strncmp(list,kindNames[k],len) == 0) break;
+    if (k == NKINDS) return 0;
+    mask |= 1 << k;
+    list += len;
+    if (*list == ',') list++;
+  }
+  return mask;
+}
+
+/************ output, wrapped at lineLength ************/
+
+static void newLine(void)
+{ fputc('\n',out);
+  column = 0;
+  line++;
+}
+
+/* writes a token, after a space if spaced (never after an open
+ * parenthesis or bracket); a token that would pass the line
+ * length goes to a continuation line */
+static void put(const char * tok, int spaced)
+{ static int opened = FALSE;
+  int len = (int) strlen(tok);
+  if (opened) spaced = FALSE;
+  opened = strcmp(tok,"(") == 0 || strcmp(tok,"[") == 0;
+  if (column > indent + 4 && column + spaced + len > lineLength)
+  { newLine();
+    fprintf(out,"%*s",indent + 4,"");
+    column = indent + 4;
+    spaced = FALSE;
+  }
+  else if (column == 0)
+  { fprintf(out,"%*s",indent,"");
+    column = indent;
+    spaced = FALSE;
+  }
+  if (spaced)
+  { fputc(' ',out);
+    column++;
+  }
+  fputs(tok,out);
+  column += len;
+}
+
+static void tok(const char * s) { put(s,TRUE); }
+static void glued(const char * s) { put(s,FALSE); }
+
+static void number(long n)
+{ char buf[24];
+  sprintf(buf,"%ld",n);
+  tok(buf);
+}
+
+static void endLine(void)
+{ if (column > 0) newLine();
+}
+
+/* the error of kind starts at this line */
+static void mark(Kind kind)
+{ fprintf(stderr,"line %ld: %s\n",line + (column > 0),kindNames[kind]);
+}
+
+/************ identifiers ************/
+
+/* the i-th of count names of a kind: prefix and i in base 26
+ * with the letters, all of the same length, identLength unless
+ * count needs more. The prefixes (f, g, l, p, a, u) start no
+ * reserved word nor input, output and main */
+static const char * name(char prefix, long i, long count)
+{ static char buf[4][64];
+  static int turn = 0;
+  char * s = buf[turn = (turn + 1) % 4];
+  int width = 1, k;
+  long c;
+  for (c = count - 1; c >= 26; c /= 26) width++;
+  if (width < identLength - 1) width = identLength - 1;
+  if (width > 62) width = 62;
+  s[0] = prefix;
+  for (k = width; k >= 1; k--)
+  { s[k] = 'a' + i % 26;
+    i /= 26;
+  }
+  s[width + 1] = '\0';
+  return s;
+}
+
+static const char * function(long i) { return name('f',i,functions); }
+static const char * global(long i) { return name('g',i,identifiers / 2); }
+static const char * local(long i) { return name('l',i,identifiers + 1); }
+static const char * param(long i) { return name('p',i,MAX_PARAMS); }
+static const char * array(long i) { return name('a',i,2); }
+
+/************ comments ************/
+
+static const char * words[] =
+{ "soma", "valor", "indice", "vetor", "laco", "teste", "resultado", "parcial",
+  "maior", "menor", "conta", "passo", "limite", "entrada", "saida", "temp" };
+
+static void comment(void)
+{ int n = 2 + (int) pick(12), i;
+  endLine();
+  tok("/*");
+  for (i = 0; i < n; i++)
+    tok(words[pick(sizeof(words) / sizeof(words[0]))]);
+  tok("*/");
+  newLine();
+}
+
+/************ expressions ************/
+
+static long current;  /* the function being generated */
+static int *arity;    /* of each function */
+
+/* an int variable in scope: a local, a parameter or a global */
+static const char * variable(void)
+{ long n = identifiers + arity[current] + identifiers / 2;
+  long i = pick(n);
+  if (i < identifiers) return local(i);
+  i -= identifiers;
+  if (i < arity[current]) return param(i);
+  return global(i - arity[current]);
+}
+
+static void expression(int d);
+
+static void call(long f, int d)
+{ int i;
+  tok(function(f));
+  glued("(");
+  for (i = 0; i < arity[f]; i++)
+  { if (i > 0) glued(",");
+    expression(d - 1);
+  }
+  glued(")");
+}
+
+static void factor(int d)
+{ switch (d > 0 ? pick(10) : pick(7))
+  { case 0: case 1: case 2:
+      tok(variable());
+      break;
+    case 3: case 4:
+      number(pick(100));
+      break;
+    case 5:
+      tok(array(pick(2)));
+      glued("[");
+      number(pick(ARRAY_SIZE));
+      glued("]");
+      break;
+    case 6:
+      tok("input");
+      glued("(");
+      glued(")");
+      break;
+    case 7: case 8:
+      if (current > 0)
+      { call(pick(current),d);
+        break;
+      }
+      /* fall through */
+    default:
+      tok("(");
+      expression(d - 1);
+      glued(")");
+  }
+}
+
+static void expression(int d)
+{ static const char * ops[] = { "+", "-", "*", "/" };
+  if (d <= 0 || chance(25))
+    factor(d);
+  else
+  { expression(d - 1);
+    tok(ops[pick(4)]);
+    factor(d - 1);
+  }
+}
+
+static void condition(void)
+{ static const char * relops[] = { "<", "<=", ">", ">=", "==", "!=" };
+  expression(exprDepth - 1);
+  tok(relops[pick(6)]);
+  expression(exprDepth - 1);
+}
+
+/************ statements ************/
+
+static void block(int level);
+
+static void assignment(void)
+{ if (chance(20))
+  { tok(array(pick(2)));
+    glued("[");
+    expression(1);
+    glued("]");
+  }
+  else tok(variable());
+  tok("=");
+  expression(exprDepth);
+  glued(";");
+}
+
+static void statement(int level)
+{ long r = level < depth ? pick(100) : pick(70);
+  if (chance(commentDensity)) comment();
+  endLine();
+  if (r < 50) assignment();
+  else if (r < 70)
+  { tok("output");
+    glued("(");
+    expression(exprDepth);
+    glued(")");
+    glued(";");
+  }
+  else if (r < 88)
+  { tok("if");
+    tok("(");
+    condition();
+    glued(")");
+    block(level + 1);
+    if (chance(40))
+    { endLine();
+      tok("else");
+      block(level + 1);
+    }
+  }
+  else
+  { tok("while");
+    tok("(");
+    condition();
+    glued(")");
+    block(level + 1);
+  }
+}
+
+static void block(int level)
+{ int i;
+  tok("{");
+  indent += 2;
+  for (i = 0; i < statements; i++)
+    statement(level);
+  indent -= 2;
+  endLine();
+  tok("}");
+}
+
+/************ injected errors ************/
+
+/* the function of each injected error, drawn from faultState */
+static long where[NKINDS];
+
+static int injectedHere(Kind kind)
+{ return (invalid & (1 << kind)) && where[kind] == current;
+}
+
+/* the errors in the declarations of the current function */
+static void declarationErrors(void)
+{ if (injectedHere(VOID_VARIABLE))
+  { endLine();
+    mark(VOID_VARIABLE);
+    tok("void");
+    tok(local(identifiers));
+    glued(";");
+  }
+  if (injectedHere(REDECL_FUNCTION))
+  { endLine();
+    mark(REDECL_FUNCTION);
+    tok("int");
+    tok(function(current));
+    glued(";");
+  }
+  if (injectedHere(REDECL_VARIABLE))
+  { endLine();
+    mark(REDECL_VARIABLE);
+    tok("int");
+    tok(local(0));
+    glued(";");
+  }
+}
+
+/* the errors in the statements of the current function */
+static void statementErrors(void)
+{ if (injectedHere(LEXICAL))
+  { endLine();
+    mark(LEXICAL);
+    tok(local(0));
+    tok("=");
+    tok(local(0));
+    tok("@");
+    number(1);
+    glued(";");
+  }
+  if (injectedHere(SYNTAX))
+  { endLine();
+    mark(SYNTAX);
+    tok(local(0));
+    tok("=");
+    number(1);
+    number(1);
+    glued(";");
+  }
+  if (injectedHere(UNDECLARED))
+  { endLine();
+    mark(UNDECLARED);
+    tok(local(0));
+    tok("=");
+    tok(name('u',current,functions));
+    glued(";");
+  }
+  if (injectedHere(VOID_USE))
+  { endLine();
+    mark(VOID_USE);
+    tok(local(0));
+    tok("=");
+    tok("output");
+    glued("(");
+    number(1);
+    glued(")");
+    glued(";");
+  }
+}
+
+/************ the program ************/
+
+static void functionDeclaration(long f)
+{ int i;
+  current = f;
+  if (chance(commentDensity)) comment();
+  endLine();
+  tok("int");
+  tok(function(f));
+  glued("(");
+  if (arity[f] == 0) glued("void");
+  for (i = 0; i < arity[f]; i++)
+  { if (i > 0) glued(",");
+    tok("int");
+    tok(param(i));
+  }
+  glued(")");
+  newLine();
+  tok("{");
+  indent = 2;
+  for (i = 0; i < identifiers; i++)
+  { endLine();
+    tok("int");
+    tok(local(i));
+    glued(";");
+  }
+  endLine();
+  tok("int");
+  tok(array(1));
+  glued("[");
+  number(ARRAY_SIZE);
+  glued("]");
+  glued(";");
+  declarationErrors();
+  statementErrors();
+  for (i = 0; i < statements; i++)
+    statement(0);
+  endLine();
+  tok("return");
+  expression(exprDepth);
+  glued(";");
+  indent = 0;
+  newLine();
+  tok("}");
+  newLine();
+  newLine();
+}
+
+static void program(void)
+{ long f;
+  int i;
+  for (i = 0; i < identifiers / 2; i++)
+  { tok("int");
+    tok(global(i));
+    glued(";");
+    newLine();
+  }
+  tok("int");
+  tok(array(0));
+  glued("[");
+  number(ARRAY_SIZE);
+  glued("]");
+  glued(";");
+  newLine();
+  newLine();
+  for (f = 0; f < functions; f++)
+    functionDeclaration(f);
+  if (invalid & (1 << NO_MAIN))
+  { mark(NO_MAIN);
+    return;
+  }
+  current = functions;
+  tok("void");
+  tok("main");
+  glued("(");
+  glued("void");
+  glued(")");
+  newLine();
+  tok("{");
+  indent = 2;
+  newLine();
+  tok("output");
+  glued("(");
+  if (functions > 0)
+  { tok(function(functions - 1));
+    glued("(");
+    for (i = 0; i < arity[functions - 1]; i++)
+    { if (i > 0) glued(",");
+      tok("input");
+      glued("(");
+      glued(")");
+    }
+    glued(")");
+  }
+  else number(0);
+  glued(")");
+  glued(";");
+  indent = 0;
+  newLine();
+  tok("}");
+  newLine();
+}
+
+/* a non-negative number option, or the usage */
+static long count(const char * value, const char * prog)
+{ char * end;
+  long n = strtol(value,&end,10);
+  if (*value == '\0' || *end != '\0' || n < 0) usage(prog);
+  return n;
+}
+
+int main( int argc, char * argv[] )
+{ const char * outFile = NULL;
+  long f;
+  int i, k;
+
+  for (i = 1; i < argc; i++)
+  { if (strcmp(argv[i],"-o") == 0 && i + 1 < argc)
+      outFile = argv[++i];
+    else if (strncmp(argv[i],"--seed=",7) == 0)
+      seed = strtoul(argv[i] + 7,NULL,10);
+    else if (strncmp(argv[i],"--functions=",12) == 0)
+      functions = count(argv[i] + 12,argv[0]);
+    else if (strncmp(argv[i],"--statements=",13) == 0)
+      statements = (int) count(argv[i] + 13,argv[0]);
+    else if (strncmp(argv[i],"--depth=",8) == 0)
+      depth = (int) count(argv[i] + 8,argv[0]);
+    else if (strncmp(argv[i],"--expr-depth=",13) == 0)
+      exprDepth = (int) count(argv[i] + 13,argv[0]);
+    else if (strncmp(argv[i],"--identifiers=",14) == 0)
+      identifiers = (int) count(argv[i] + 14,argv[0]);
+    else if (strncmp(argv[i],"--ident-length=",15) == 0)
+      identLength = (int) count(argv[i] + 15,argv[0]);
+    else if (strncmp(argv[i],"--comments=",11) == 0)
+      commentDensity = (int) count(argv[i] + 11,argv[0]);
+    else if (strncmp(argv[i],"--line-length=",14) == 0)
+      lineLength = (int) count(argv[i] + 14,argv[0]);
+    else if (strncmp(argv[i],"--invalid=",10) == 0)
+    { invalid = parseKinds(argv[i] + 10);
+      if (invalid == 0) usage(argv[0]);
+    }
+    else
+    { fprintf(stderr,"unknown option: %s\n",argv[i]);
+      usage(argv[0]);
+    }
+  }
+  /* the injected errors use a local and a function */
+  if (identifiers < 1 || commentDensity > 100 ||
+      (functions < 1 && (invalid & ~(1 << NO_MAIN)) != 0))
+    usage(argv[0]);
+
+  shapeState = seed;
+  faultState = seed ^ 0x5DEECE66DULL;
+  for (k = 0; k < NKINDS; k++)
+    where[k] = functions > 0 ? (long) (next(&faultState) % functions) : 0;
+  arity = (int *) malloc((functions + 1) * sizeof(int));
+  for (f = 0; f < functions; f++)
+    arity[f] = (int) pick(MAX_PARAMS + 1);
+
+  out = stdout;
+  if (outFile != NULL && (out = fopen(outFile,"w")) == NULL)
+  { perror(outFile);
+    return 1;
+  }
+  program();
+  free(arity);
+  if (fclose(out) != 0)
+  { perror(outFile != NULL ? outFile : "stdout");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,426 @@
+/****************************************************/
+/* File: cmtest.c                                   */
+/* Parallel regression runner: compiles each source */
+/* with mycmcomp and compares its outputs with the  */
+/* golden files, N jobs at a time                   */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#define MAX_ARGS 32
+
+/* the compared outputs; a job exits with one bit per failed
+ * stage, and CRASHED if the compiler could not finish */
+typedef enum { OUT, ERR, LEX, SYN, TAB, GEN, NSTAGES } Stage;
+#define CRASHED (1 << NSTAGES)
+
+static const char * stageNames[NSTAGES] = { "out", "err", "lex", "syn", "tab", "gen" };
+/* file of the stage, after the base name of the source */
+static const char * suffixes[NSTAGES] = { ".out", "_err.txt", "_lex.txt", "_syn.txt", "_tab.txt", "_gen.tm" };
+
+typedef enum { PENDING, PASS, FAIL, SKIP } Result;
+static const char * resultNames[] = { "pending", "pass", "fail", "skip" };
+
+typedef struct
+{ const char * source;
+  char base[256];     /* name without directory and extension */
+  pid_t pid;
+  int compared;       /* stages with a golden file */
+  Result results[NSTAGES];
+  int crashed;
+  double seconds;
+  struct timespec start;
+} Job;
+
+/* options */
+static const char * compiler = "./mycmcomp";
+static const char * goldenDir = NULL;     /* --golden: the stage files */
+static const char * goldenOutDir = NULL;  /* --golden-out: the stdout of each source */
+static const char * outDir = "cmtest.out";
+static const char * junitFile = NULL;
+static const char * jsonFile = NULL;
+static int stages = (1 << NSTAGES) - 1;
+static int jobs = 0;
+static int timeout = 0;                   /* seconds per source, 0 = none */
+static int verbose = FALSE;
+static char * compilerArgs[MAX_ARGS];
+static int nCompilerArgs = 0;
+
+static void usage(const char * prog)
+{ fprintf(stderr,"usage: %s [options] <file.cm>...\n",prog);
+  fprintf(stderr,"options:\n");
+  fprintf(stderr,"  -j N                 run N jobs at a time (default: the online CPUs)\n");
+  fprintf(stderr,"  --compiler=PATH      mycmcomp to run (default ./mycmcomp)\n");
+  fprintf(stderr,"  -a ARG               pass ARG to the compiler (repeatable)\n");
+  fprintf(stderr,"  --golden=DIR         golden stage files (<name>_lex.txt, ...)\n");
+  fprintf(stderr,"  --golden-out=DIR     golden stdout of each source (<name>.out)\n");
+  fprintf(stderr,"  --stages=LIST        compare only these: out,err,lex,syn,tab,gen\n");
+  fprintf(stderr,"  --out=DIR            outputs and .diff files (default cmtest.out)\n");
+  fprintf(stderr,"  --junit=FILE         write a JUnit XML report\n");
+  fprintf(stderr,"  --json=FILE          write a JSON report\n");
+  fprintf(stderr,"  --timeout=SECONDS    kill a compilation that runs longer\n");
+  fprintf(stderr,"  -v                   print each source when it is done\n");
+  exit(2);
+}
+
+static int parseStages(const char * list)
+{ int mask = 0;
+  while (*list != '\0')
+  { size_t len = strcspn(list,",");
+    int i;
+    for (i = 0; i < NSTAGES; i++)
+      if (strlen(stageNames[i]) == len && strncmp(list,stageNames[i],len) == 0) break;
+    if (i == NSTAGES) return 0;
+    mask |= 1 << i;
+    list += len;
+    if (*list == ',') list++;
+  }
+  return mask;
+}
+
+static double elapsed(struct timespec * since)
+{ struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) * 1e-9;
+}
+
+static int exists(const char * file)
+{ struct stat st;
+  return stat(file, &st) == 0;
+}
+
+/* <out>/<name>.diff for the stdout, <out>/<name>_<stage>.diff
+ * for the others, as the scripts name them */
+static void diffName(char * buf, size_t size, Job * job, Stage stage)
+{ if (stage == OUT) snprintf(buf, size, "%s/%s.diff", outDir, job->base);
+  else snprintf(buf, size, "%s/%s_%s.diff", outDir, job->base, stageNames[stage]);
+}
+
+/* runs argv with stdout (and stderr) sent to the file out;
+ * returns the exit status, or -1 if it did not exit */
+static int run(char * const argv[], const char * out, int seconds)
+{ pid_t pid = fork();
+  int status;
+  if (pid < 0) return -1;
+  if (pid == 0)
+  { int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) _exit(127);
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+    if (seconds > 0) alarm(seconds); /* survives the exec */
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+  while (waitpid(pid, &status, 0) < 0)
+    if (errno != EINTR) return -1;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* the body of a job, in its own process: compile, then diff
+ * each stage that has a golden file */
+static int runJob(Job * job, int compared)
+{ char * argv[MAX_ARGS + 4];
+  char out[512], detail[512], golden[512], diffFile[512];
+  int i, n = 0, failed = 0;
+
+  snprintf(out, sizeof(out), "%s/%s.out", outDir, job->base);
+  snprintf(detail, sizeof(detail), "%s/", outDir);
+  argv[n++] = (char *) compiler;
+  for (i = 0; i < nCompilerArgs; i++)
+    argv[n++] = compilerArgs[i];
+  argv[n++] = (char *) job->source;
+  argv[n++] = detail;
+  argv[n] = NULL;
+  /* errors in the source are compared like any output: only a
+   * crash, a timeout or a failed exec fail the job by themselves */
+  i = run(argv, out, timeout);
+  if (i < 0 || i == 127) failed |= CRASHED;
+
+  for (i = 0; i < NSTAGES; i++)
+  { char mine[512];
+    char * diff[8];
+    int k = 0;
+    if (!(compared & (1 << i))) continue;
+    snprintf(mine, sizeof(mine), "%s/%s%s", outDir, job->base, suffixes[i]);
+    snprintf(golden, sizeof(golden), "%s/%s%s", i == OUT ? goldenOutDir : goldenDir,
+             job->base, suffixes[i]);
+    diffName(diffFile, sizeof(diffFile), job, (Stage) i);
+    if (!exists(mine)) /* not written: compared with nothing */
+      snprintf(mine, sizeof(mine), "/dev/null");
+    diff[k++] = "diff";
+    if (i == OUT)
+    { /* as scripts/rundiff; the banner holds the path of the source */
+      diff[k++] = "-ZbBE";
+      diff[k++] = "--strip-trailing-cr";
+      diff[k++] = "-I^TINY COMPILATION:";
+    }
+    else diff[k++] = "-ZbB";
+    diff[k++] = mine;
+    diff[k++] = golden;
+    diff[k] = NULL;
+    if (run(diff, diffFile, 0) != 0) failed |= 1 << i;
+  }
+  return failed;
+}
+
+static void startJob(Job * job)
+{ char golden[512];
+  int i;
+  const char * base = strrchr(job->source, '/') ? strrchr(job->source, '/') + 1 : job->source;
+  snprintf(job->base, sizeof(job->base), "%.*s", (int) strcspn(base, "."), base);
+  job->compared = 0;
+  for (i = 0; i < NSTAGES; i++)
+  { const char * dir = i == OUT ? goldenOutDir : goldenDir;
+    job->results[i] = SKIP;
+    if (!(stages & (1 << i)) || dir == NULL) continue;
+    snprintf(golden, sizeof(golden), "%s/%s%s", dir, job->base, suffixes[i]);
+    if (exists(golden))
+    { job->compared |= 1 << i;
+      job->results[i] = PENDING;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &job->start);
+  fflush(NULL);
+  job->pid = fork();
+  if (job->pid == 0)
+    _exit(runJob(job, job->compared));
+  if (job->pid < 0)
+  { perror("fork");
+    exit(2);
+  }
+}
+
+static void finishJob(Job * job, int status)
+{ int failed = WIFEXITED(status) ? WEXITSTATUS(status) : CRASHED;
+  int i;
+  job->seconds = elapsed(&job->start);
+  job->crashed = (failed & CRASHED) != 0;
+  for (i = 0; i < NSTAGES; i++)
+    if (job->results[i] == PENDING)
+      job->results[i] = (failed & (1 << i)) ? FAIL : PASS;
+  if (verbose || job->crashed)
+  { printf("%-32s", job->source);
+    if (job->crashed) printf(" CRASHED");
+    for (i = 0; i < NSTAGES; i++)
+      if (job->results[i] != SKIP)
+        printf(" %s:%s", stageNames[i], resultNames[job->results[i]]);
+    printf(" (%.2fs)\n", job->seconds);
+  }
+}
+
+static int jobFailed(Job * job)
+{ int i;
+  if (job->crashed) return TRUE;
+  for (i = 0; i < NSTAGES; i++)
+    if (job->results[i] == FAIL) return TRUE;
+  return FALSE;
+}
+
+static void xmlEscaped(FILE * f, const char * s)
+{ for (; *s != '\0'; s++)
+    switch (*s)
+    { case '<': fputs("&lt;", f); break;
+      case '>': fputs("&gt;", f); break;
+      case '&': fputs("&amp;", f); break;
+      case '"': fputs("&quot;", f); break;
+      default: fputc(*s, f);
+    }
+}
+
+static void jsonEscaped(FILE * f, const char * s)
+{ fputc('"', f);
+  for (; *s != '\0'; s++)
+  { if (*s == '"' || *s == '\\') fputc('\\', f);
+    fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+/* one test case per source and stage, grouped by stage */
+static void writeJunit(const char * file, Job * all, int n, double seconds)
+{ FILE * f = fopen(file, "w");
+  int i, s;
+  if (f == NULL)
+  { perror(file);
+    return;
+  }
+  fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+  fprintf(f, "<testsuites name=\"cmtest\" time=\"%.3f\">\n", seconds);
+  for (s = 0; s < NSTAGES; s++)
+  { int tests = 0, failures = 0, skipped = 0;
+    for (i = 0; i < n; i++)
+    { tests++;
+      if (all[i].results[s] == FAIL || (all[i].crashed && all[i].results[s] != SKIP)) failures++;
+      else if (all[i].results[s] == SKIP) skipped++;
+    }
+    fprintf(f, "  <testsuite name=\"%s\" tests=\"%d\" failures=\"%d\" skipped=\"%d\">\n",
+            stageNames[s], tests, failures, skipped);
+    for (i = 0; i < n; i++)
+    { Job * job = &all[i];
+      fprintf(f, "    <testcase classname=\"%s\" name=\"", stageNames[s]);
+      xmlEscaped(f, job->base);
+      fprintf(f, "\" time=\"%.3f\"", job->seconds);
+      if (job->results[s] == SKIP)
+        fprintf(f, "><skipped/></testcase>\n");
+      else if (job->crashed)
+        fprintf(f, "><failure message=\"compiler crashed or timed out\"/></testcase>\n");
+      else if (job->results[s] == FAIL)
+      { char diffFile[512];
+        diffName(diffFile, sizeof(diffFile), job, (Stage) s);
+        fprintf(f, "><failure message=\"differs, see ");
+        xmlEscaped(f, diffFile);
+        fprintf(f, "\"/></testcase>\n");
+      }
+      else fprintf(f, "/>\n");
+    }
+    fprintf(f, "  </testsuite>\n");
+  }
+  fprintf(f, "</testsuites>\n");
+  fclose(f);
+}
+
+static void writeJson(const char * file, Job * all, int n, int totals[NSTAGES][4], double seconds)
+{ FILE * f = fopen(file, "w");
+  int i, s;
+  if (f == NULL)
+  { perror(file);
+    return;
+  }
+  fprintf(f, "{\"seconds\": %.3f,\n \"summary\": {", seconds);
+  for (s = 0; s < NSTAGES; s++)
+    fprintf(f, "%s\"%s\": {\"pass\": %d, \"fail\": %d, \"skip\": %d}", s ? ", " : "",
+            stageNames[s], totals[s][PASS], totals[s][FAIL], totals[s][SKIP]);
+  fprintf(f, "},\n \"sources\": [");
+  for (i = 0; i < n; i++)
+  { fprintf(f, "%s\n  {\"source\": ", i ? "," : "");
+    jsonEscaped(f, all[i].source);
+    fprintf(f, ", \"passed\": %s, \"crashed\": %s, \"seconds\": %.3f, \"stages\": {",
+            jobFailed(&all[i]) ? "false" : "true", all[i].crashed ? "true" : "false",
+            all[i].seconds);
+    for (s = 0; s < NSTAGES; s++)
+      fprintf(f, "%s\"%s\": \"%s\"", s ? ", " : "", stageNames[s],
+              resultNames[all[i].results[s]]);
+    fprintf(f, "}}");
+  }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+}
+
+int main( int argc, char * argv[] )
+{ Job * all;
+  int nSources = 0, next = 0, running = 0, failedSources = 0, crashed = 0;
+  int totals[NSTAGES][4];
+  struct timespec start;
+  double seconds;
+  int i, s;
+
+  all = (Job *) calloc(argc, sizeof(Job));
+  for (i = 1; i < argc; i++)
+  { if (strcmp(argv[i],"-j") == 0 && i + 1 < argc)
+      jobs = atoi(argv[++i]);
+    else if (strncmp(argv[i],"-j",2) == 0 && argv[i][2] != '\0')
+      jobs = atoi(argv[i] + 2);
+    else if (strcmp(argv[i],"-a") == 0 && i + 1 < argc)
+    { if (nCompilerArgs == MAX_ARGS) usage(argv[0]);
+      compilerArgs[nCompilerArgs++] = argv[++i];
+    }
+    else if (strncmp(argv[i],"--compiler=",11) == 0)
+      compiler = argv[i] + 11;
+    else if (strncmp(argv[i],"--golden=",9) == 0)
+      goldenDir = argv[i] + 9;
+    else if (strncmp(argv[i],"--golden-out=",13) == 0)
+      goldenOutDir = argv[i] + 13;
+    else if (strncmp(argv[i],"--stages=",9) == 0)
+    { stages = parseStages(argv[i] + 9);
+      if (stages == 0) usage(argv[0]);
+    }
+    else if (strncmp(argv[i],"--out=",6) == 0)
+      outDir = argv[i] + 6;
+    else if (strncmp(argv[i],"--junit=",8) == 0)
+      junitFile = argv[i] + 8;
+    else if (strncmp(argv[i],"--json=",7) == 0)
+      jsonFile = argv[i] + 7;
+    else if (strncmp(argv[i],"--timeout=",10) == 0)
+      timeout = atoi(argv[i] + 10);
+    else if (strcmp(argv[i],"-v") == 0)
+      verbose = TRUE;
+    else if (argv[i][0] == '-')
+    { fprintf(stderr,"unknown option: %s\n",argv[i]);
+      usage(argv[0]);
+    }
+    else all[nSources++].source = argv[i];
+  }
+  if (nSources == 0 || (goldenDir == NULL && goldenOutDir == NULL)) usage(argv[0]);
+  if (jobs <= 0) jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (jobs <= 0) jobs = 1;
+  if (mkdir(outDir, 0755) != 0 && errno != EEXIST)
+  { perror(outDir);
+    return 2;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (next < nSources || running > 0)
+  { int status;
+    pid_t pid;
+    while (running < jobs && next < nSources)
+    { startJob(&all[next++]);
+      running++;
+    }
+    pid = wait(&status);
+    if (pid < 0)
+    { if (errno == EINTR) continue;
+      perror("wait");
+      return 2;
+    }
+    for (i = 0; i < next; i++)
+      if (all[i].pid == pid)
+      { all[i].pid = 0;
+        finishJob(&all[i], status);
+        running--;
+        break;
+      }
+  }
+  seconds = elapsed(&start);
+
+  memset(totals, 0, sizeof(totals));
+  for (i = 0; i < nSources; i++)
+  { if (all[i].crashed) crashed++;
+    if (jobFailed(&all[i])) failedSources++;
+    for (s = 0; s < NSTAGES; s++)
+      totals[s][all[i].crashed && all[i].results[s] != SKIP ? FAIL : all[i].results[s]]++;
+  }
+
+  printf("\nstage    pass  fail  skip\n");
+  printf("-----  ------  ----  ----\n");
+  for (s = 0; s < NSTAGES; s++)
+    printf("%-5s  %6d  %4d  %4d\n", stageNames[s], totals[s][PASS], totals[s][FAIL], totals[s][SKIP]);
+  if (failedSources > 0)
+  { printf("failing:");
+    for (i = 0; i < nSources; i++)
+      if (jobFailed(&all[i])) printf(" %s", all[i].base);
+    printf("\n");
+  }
+  printf("%d of %d sources pass (%d crashed), %d jobs, %.2fs; diffs in %s/\n",
+         nSources - failedSources, nSources, crashed, jobs, seconds, outDir);
+
+  if (junitFile != NULL) writeJunit(junitFile, all, nSources, seconds);
+  if (jsonFile != NULL) writeJson(jsonFile, all, nSources, totals, seconds);
+  return failedSources > 0 ? 1 : 0;
+}